@@ -0,0 +1,468 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Benchmarks against generated data at production scale. Includes the same
+// implementation copy as Unittest.c, pointed at its own CSV.
+//   ./Benchmark [--perf] [ROWS]               generate ROWS orders (default 1000000) and time every operation
+//   ./Benchmark --generate ROWS FILE [SEED]   only write a data file
+// Build: gcc -O2 Benchmark.c -o Benchmark -lm -pthread
+// The generator is deterministic for a given seed: product names follow a
+// Zipf-like skew, about 1% of rows reuse an earlier OrderID and 0.5% are
+// malformed. Each operation reports throughput and p50/p99 latency; the
+// cheapest ones are timed in blocks of BLOCK calls and divided. With --perf
+// each also reports hardware counters per line, row or operation.
+
+#define CSV_FILE "Benchorders.csv"
+#include "OrderManagerForUnittest.c"
+
+#define DEFAULT_ROWS 1000000
+#define DEFAULT_SEED 42
+#define ID_BASE      1000000
+#define IMPORT_FILE  "Benchimport.csv"
+#define BLOCK        64
+#define SEARCHES     300
+#define EDITS        20000
+
+/* ------------------------------ generator ------------------------------ */
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static const char* adjectives[] = {
+    "Steel", "Blue", "Mini", "Large", "Brass", "Oak", "Red", "Smart", "Glass", "Heavy",
+    "Cotton", "Silver", "Green", "Pocket", "Twin", "Round", "Carbon", "Vintage", "Black", "Soft"
+};
+static const char* nouns[] = {
+    "Bolt", "Mug", "Lamp", "Chair", "Cable", "Fan", "Rug", "Pot", "Vase", "Desk",
+    "Pen", "Hat", "Bag", "Cup", "Clock", "Shelf", "Knife", "Towel", "Phone", "Brush",
+    "Hammer", "Kettle", "Mirror", "Pillow", "Router", "Screw", "Bottle", "Candle", "Drill", "Spoon",
+    "Wallet", "Helmet", "Bucket", "Charger", "Blanket", "Speaker", "Jacket", "Basket", "Ladder", "Socket"
+};
+static const char* firsts[] = {
+    "Ann", "Ben", "Cara", "Dan", "Eve", "Finn", "Gia", "Hugo", "Ivy", "Jon",
+    "Kai", "Lia", "Max", "Nia", "Omar", "Pia", "Quin", "Rex", "Sam", "Tia"
+};
+static const char* lasts[] = {
+    "Smith", "Lee", "Brown", "Garcia", "Khan", "Silva", "Muller", "Rossi", "Tanaka", "Novak",
+    "Wong", "Dubois", "Jensen", "Costa", "Ivanov", "Park", "Sato", "Nguyen", "Moreau", "Kowal"
+};
+
+#define NADJ  (sizeof adjectives / sizeof *adjectives)
+#define NNOUN (sizeof nouns / sizeof *nouns)
+#define NPROD (NADJ * NNOUN)
+
+static double zipf_cdf[NPROD];
+
+// rank k is drawn with weight 1/(k+1): a few products dominate, most are rare
+static void zipf_init(void) {
+    double sum = 0;
+    for (size_t k = 0; k < NPROD; ++k) sum += 1.0 / (double)(k + 1);
+    double acc = 0;
+    for (size_t k = 0; k < NPROD; ++k) {
+        acc += 1.0 / (double)(k + 1) / sum;
+        zipf_cdf[k] = acc;
+    }
+}
+
+static size_t zipf_draw(void) {
+    double u = (double)(rng_next() >> 11) / 9007199254740992.0;
+    size_t lo = 0, hi = NPROD - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (zipf_cdf[mid] < u) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// product of popularity rank k; ranks are spread so popular names differ in both words
+static void product_name(size_t k, char* out, size_t cap) {
+    snprintf(out, cap, "%s %s", adjectives[(k * 7) % NADJ], nouns[(k * 7 / NADJ + k) % NNOUN]);
+}
+
+static size_t gen_line(char* buf, size_t cap, size_t i) {
+    uint64_t r = rng_next();
+    unsigned kind = (unsigned)(r % 1000);
+    if (kind < 5) {     // malformed, in the ways real files go wrong
+        static const char* bad[] = {
+            "%lu,Walk In,,3,2.50,01-02-2023\n",
+            "%lu,Walk In,Gift Card,three,2.50,01-02-2023\n",
+            "%lu,Walk In,Gift Card,1,2.50,31-02-2023\n",
+            "%lu;Walk In;Gift Card;1;2.50;01-02-2023\n",
+            "#%lu exported by legacy till\n"
+        };
+        return (size_t)snprintf(buf, cap, bad[kind], (unsigned long)(ID_BASE + i));
+    }
+    unsigned long id = ID_BASE + i;
+    if (kind < 15 && i > 0) id = ID_BASE + (unsigned long)(rng_next() % i);  // duplicate ID
+    char prod[40];
+    product_name(zipf_draw(), prod, sizeof prod);
+    uint64_t s = rng_next();
+    int qty = 1 + (int)(s % 10) * (int)((s >> 8) % 10 == 0 ? 20 : 1);
+    unsigned cents = 50 + (unsigned)((s >> 16) % 99950);
+    int day = 1 + (int)((s >> 32) % 28), month = 1 + (int)((s >> 40) % 12), year = 2020 + (int)((s >> 48) % 6);
+    return (size_t)snprintf(buf, cap, "%lu,%s %s,%s,%d,%u.%02u,%02d-%02d-%04d\n",
+                            id, firsts[(s >> 4) % 20], lasts[(s >> 12) % 20], prod,
+                            qty, cents / 100, cents % 100, day, month, year);
+}
+
+// rows data lines (with or without the header), ids from first_id on
+static int generate(const char* path, size_t rows, size_t first, uint64_t seed, int header) {
+    FILE* f = fopen(path, "wb");
+    if (!f) { perror(path); return 0; }
+    rng_state = seed ? seed : 1;
+    char* buf = malloc(1 << 20);
+    size_t len = 0;
+    if (header) len = (size_t)sprintf(buf, "orderid,customername,productname,quantity,price,orderdate\n");
+    for (size_t i = 0; i < rows; ++i) {
+        len += gen_line(buf + len, 256, first + i);
+        if (len > (1 << 20) - 256) { fwrite(buf, 1, len, f); len = 0; }
+    }
+    fwrite(buf, 1, len, f);
+    free(buf);
+    return fclose(f) == 0;
+}
+
+/* ------------------------------ measuring ------------------------------ */
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void fmt_time(double secs, char* out, size_t cap) {
+    if (secs < 1e-6) snprintf(out, cap, "%.0f ns", secs * 1e9);
+    else if (secs < 1e-3) snprintf(out, cap, "%.1f us", secs * 1e6);
+    else snprintf(out, cap, "%.2f ms", secs * 1e3);
+}
+
+// samples are seconds per operation; total is wall time for all ops
+static void report(const char* name, size_t ops, double total, double* lat, size_t nlat) {
+    char p50[32] = "-", p99[32] = "-";
+    if (nlat) {
+        qsort(lat, nlat, sizeof *lat, cmp_double);
+        fmt_time(lat[nlat / 2], p50, sizeof p50);
+        fmt_time(lat[nlat * 99 / 100], p99, sizeof p99);
+    }
+    printf("[BENCH] %-16s %10lu ops %12.0f ops/s   p50 %-10s p99 %s\n",
+           name, (unsigned long)ops, total > 0 ? ops / total : 0.0, p50, p99);
+}
+
+/* --------------------------- hardware counters -------------------------- */
+
+// Cycles, instructions, branch misses and last-level cache misses through
+// perf_event_open, for this process and the threads it starts (user space
+// only, so the default perf_event_paranoid allows it). Counters the kernel
+// refuses are left out; if it refuses all of them the benchmark runs without.
+
+enum { HW_CYCLES, HW_INSTR, HW_BRANCH_MISS, HW_LLC_MISS, HW_COUNT };
+
+static const char* hw_names[HW_COUNT] = { "cycles", "instr", "br-miss", "LLC-miss" };
+static int hw_fd[HW_COUNT] = { -1, -1, -1, -1 };
+static int hw_any;
+
+typedef struct {
+    uint64_t value[HW_COUNT], enabled[HW_COUNT], running[HW_COUNT];
+} HwCount;
+
+#ifdef __linux__
+static int hw_open_one(uint32_t type, uint64_t config) {
+    struct perf_event_attr pe;
+    memset(&pe, 0, sizeof pe);
+    pe.size = sizeof pe;
+    pe.type = type;
+    pe.config = config;
+    pe.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    pe.inherit = 1;             // scan pool and import threads started later count too
+    pe.exclude_kernel = 1;
+    pe.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+}
+
+// before any thread is started, so that they all inherit the counters
+static void hw_open(void) {
+    hw_fd[HW_CYCLES] = hw_open_one(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    int why = errno;
+    hw_fd[HW_INSTR] = hw_open_one(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    hw_fd[HW_BRANCH_MISS] = hw_open_one(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    hw_fd[HW_LLC_MISS] = hw_open_one(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                     | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    for (int k = 0; k < HW_COUNT; ++k) hw_any |= hw_fd[k] >= 0;
+    if (!hw_any) {
+        int level = -1;
+        FILE* f = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        if (f) { if (fscanf(f, "%d", &level) != 1) level = -1; fclose(f); }
+        printf("[BENCH] hardware counters unavailable (%s, perf_event_paranoid %d); timing only\n",
+               strerror(why), level);
+        return;
+    }
+    printf("[BENCH] hardware counters:");
+    for (int k = 0; k < HW_COUNT; ++k) printf(" %s%s", hw_names[k], hw_fd[k] >= 0 ? "" : " (unavailable)");
+    printf("\n");
+}
+
+static void hw_read(HwCount* c) {
+    for (int k = 0; k < HW_COUNT; ++k) {
+        uint64_t v[3] = { 0, 0, 0 };
+        if (hw_fd[k] >= 0 && read(hw_fd[k], v, sizeof v) != (ssize_t)sizeof v) v[0] = v[1] = v[2] = 0;
+        c->value[k] = v[0];
+        c->enabled[k] = v[1];
+        c->running[k] = v[2];
+    }
+}
+#else
+static void hw_open(void) {
+    printf("[BENCH] hardware counters need Linux perf events; timing only\n");
+}
+
+static void hw_read(HwCount* c) {
+    memset(c, 0, sizeof *c);
+}
+#endif
+
+static void hw_start(HwCount* c) {
+    if (hw_any) hw_read(c);
+}
+
+// turns the reading from hw_start into what was counted since, scaled up
+// when the kernel had to multiplex the counters
+static void hw_stop(HwCount* c) {
+    if (!hw_any) return;
+    HwCount now;
+    hw_read(&now);
+    for (int k = 0; k < HW_COUNT; ++k) {
+        uint64_t v = now.value[k] - c->value[k], on = now.enabled[k] - c->enabled[k], ran = now.running[k] - c->running[k];
+        c->value[k] = ran ? (uint64_t)((double)v * ((double)on / (double)ran)) : 0;
+        c->running[k] = ran;
+    }
+}
+
+static void hw_report(const HwCount* c, const char* unit, size_t n) {
+    if (!hw_any || !n) return;
+    const char* sep = ":";
+    printf("        per %s", unit);
+    for (int k = 0; k < HW_COUNT; ++k) {
+        if (hw_fd[k] < 0 || !c->running[k]) continue;
+        double per = (double)c->value[k] / (double)n;
+        printf(per < 10 ? "%s %.3f %s" : "%s %.0f %s", sep, per, hw_names[k]);
+        if (k == HW_INSTR && c->running[HW_CYCLES] && c->value[HW_CYCLES])
+            printf(" (IPC %.2f)", (double)c->value[HW_INSTR] / (double)c->value[HW_CYCLES]);
+        sep = ",";
+    }
+    printf("\n");
+}
+
+static char* slurp(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return NULL; }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = malloc((size_t)n + 1);
+    if (buf) buf[fread(buf, 1, (size_t)n, f)] = '\0';
+    fclose(f);
+    return buf;
+}
+
+static void bench_parse(const char* path) {
+    char* text = slurp(path);
+    if (!text) return;
+    size_t nlines = 0;
+    for (char* p = text; *p; ++p) nlines += *p == '\n';
+    char** lines = malloc(nlines * sizeof *lines);
+    size_t n = 0;
+    for (char* p = strtok(text, "\n"); p && n < nlines; p = strtok(NULL, "\n")) lines[n++] = p;
+
+    double* lat = malloc((n / BLOCK + 1) * sizeof *lat);
+    size_t nlat = 0, ok = 0;
+    int id, qty;
+    float price;
+    char cust[64], prod[64], date[32];
+    HwCount hw;
+    hw_start(&hw);
+    double t0 = now_seconds();
+    for (size_t i = 0; i < n; i += BLOCK) {
+        size_t end = i + BLOCK < n ? i + BLOCK : n;
+        double b = now_seconds();
+        for (size_t k = i; k < end; ++k) ok += parse_csv_line(lines[k], &id, cust, prod, &qty, &price, date);
+        lat[nlat++] = (now_seconds() - b) / (double)(end - i);
+    }
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report("parse_csv_line", n, secs, lat, nlat);
+    printf("        %lu of %lu lines parsed as orders\n", (unsigned long)ok, (unsigned long)n);
+    hw_report(&hw, "line", n);
+    free(lat);
+    free(lines);
+    free(text);
+}
+
+static void bench_lookup(size_t rows) {
+    size_t n = rows < 1000000 ? 1000000 : rows, nlat = 0, hits = 0;
+    double* lat = malloc((n / BLOCK + 1) * sizeof *lat);
+    rng_state = 7;
+    HwCount hw;
+    hw_start(&hw);
+    double t0 = now_seconds();
+    for (size_t i = 0; i < n; i += BLOCK) {
+        double b = now_seconds();
+        for (size_t k = 0; k < BLOCK; ++k)
+            hits += idx_first(&store.ids, (int)(ID_BASE + rng_next() % rows)) != ID_EMPTY;
+        lat[nlat++] = (now_seconds() - b) / BLOCK;
+    }
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report("id lookup", nlat * BLOCK, secs, lat, nlat);
+    printf("        %lu hits\n", (unsigned long)hits);
+    hw_report(&hw, "lookup", nlat * BLOCK);
+    free(lat);
+}
+
+// a mix of what people type: popular and rare full names, single words, fragments
+static void bench_search(void) {
+    double lat[SEARCHES];
+    size_t matched = 0;
+    rng_state = 11;
+    HwCount hw;
+    hw_start(&hw);
+    double t0 = now_seconds();
+    for (int i = 0; i < SEARCHES; ++i) {
+        char name[40], needle[40];
+        product_name(i % 3 == 0 ? (size_t)(rng_next() % 10) : (size_t)(rng_next() % NPROD), name, sizeof name);
+        switch (i % 4) {
+        case 0: case 1: strcpy(needle, name); break;
+        case 2: strcpy(needle, strchr(name, ' ') + 1); break;          // the noun
+        default: snprintf(needle, sizeof needle, "%.2s", name); break; // two letters: full scan
+        }
+        lowercase(needle);
+        size_t* hits;
+        double b = now_seconds();
+        matched += product_matches(needle, &hits);
+        lat[i] = now_seconds() - b;
+        free(hits);
+    }
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report("product search", SEARCHES, secs, lat, SEARCHES);
+    printf("        %lu rows matched\n", (unsigned long)matched);
+    hw_report(&hw, "search", SEARCHES);
+    hw_report(&hw, "stored row", SEARCHES * store.len);
+}
+
+// UPDATE or DELETE through batch mode: lock, sync check, log append, memory
+static void bench_edit(const char* name, size_t rows, int del) {
+    double* lat = malloc(EDITS * sizeof *lat);
+    Reply out = { NULL, 0, 0, 0 };
+    size_t failed = 0;
+    rng_state = del ? 13 : 17;
+    HwCount hw;
+    hw_start(&hw);
+    double t0 = now_seconds();
+    for (int i = 0; i < EDITS; ++i) {
+        char cmd[64];
+        unsigned long id = ID_BASE + (unsigned long)(del ? ((size_t)i * 7919) % rows : rng_next() % rows);
+        if (del) snprintf(cmd, sizeof cmd, "DELETE %lu", id);
+        else snprintf(cmd, sizeof cmd, "UPDATE %lu,,,%d,,", id, i % 50);
+        out.len = 0;
+        double b = now_seconds();
+        batch_answer(cmd, &out);
+        lat[i] = now_seconds() - b;
+        failed += out.len < 2 || strncmp(out.buf, "OK", 2) != 0;
+    }
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report(name, EDITS, secs, lat, EDITS);
+    printf("        %lu not found\n", (unsigned long)failed);
+    hw_report(&hw, del ? "delete" : "update", EDITS);
+    free(out.buf);
+    free(lat);
+}
+
+static void bench_import(size_t rows) {
+    size_t n = rows / 10 ? rows / 10 : 1;
+    if (!generate(IMPORT_FILE, n, rows, DEFAULT_SEED + 1, 1)) return;
+    struct stat st;
+    stat(IMPORT_FILE, &st);
+    fflush(stdout);     // import_csv lists rejected lines on stderr and prints its own summary
+    HwCount hw;
+    hw_start(&hw);
+    double t0 = now_seconds();
+    int ok = import_csv(IMPORT_FILE);
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report("import", n, secs, NULL, 0);
+    printf("        %.1f MB/s%s\n", (double)st.st_size / 1e6 / (secs > 0 ? secs : 1e-9), ok ? "" : ", import FAILED");
+    hw_report(&hw, "line", n);
+    remove(IMPORT_FILE);
+}
+
+int main(int argc, char** argv) {
+    // the app's menus, daemon and command-line entry points come along with
+    // the include; none of them is timed here
+    (void)Addcsv; (void)searchMenu; (void)updateOrderByID; (void)deleteByOrderID;
+    (void)serve; (void)batch_run; (void)idx_file_lookup; (void)store_checkpoint;
+    (void)commit_parse_mode; (void)stats_print; (void)stats_dump; (void)trace_start; (void)trace_dump;
+
+    zipf_init();
+    if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+        size_t rows = strtoul(argv[2], NULL, 10);
+        uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 10) : DEFAULT_SEED;
+        return generate(argv[3], rows, 0, seed, 1) ? 0 : 1;
+    }
+    int perf = argc > 1 && strcmp(argv[1], "--perf") == 0;
+    if (perf) {
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+    size_t rows = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ROWS;
+    if (!rows) { printf("Usage: %s [--perf] [ROWS] | --generate ROWS FILE [SEED]\n", argv[0]); return 2; }
+    if (perf) hw_open();
+
+    remove(CSV_FILE);
+    remove(WAL_FILE);
+    double t0 = now_seconds();
+    if (!generate(CSV_FILE, rows, 0, DEFAULT_SEED, 1)) return 1;
+    struct stat st;
+    stat(CSV_FILE, &st);
+    printf("[BENCH] generated %lu rows (%.1f MB) in %.2f s\n",
+           (unsigned long)rows, (double)st.st_size / 1e6, now_seconds() - t0);
+
+    bench_parse(CSV_FILE);
+    HwCount hw;
+    hw_start(&hw);
+    t0 = now_seconds();
+    if (!store_load()) return 1;
+    double secs = now_seconds() - t0;
+    hw_stop(&hw);
+    report("load", store.len, secs, NULL, 0);
+    printf("        %.1f MB/s with %lu scan thread(s)\n",
+           (double)st.st_size / 1e6 / (secs > 0 ? secs : 1e-9), (unsigned long)scan_width());
+    hw_report(&hw, "row", store.len);
+    bench_lookup(rows);
+    bench_search();
+    bench_edit("update", rows, 0);
+    bench_edit("delete", rows, 1);
+    bench_import(rows);
+
+    compact_wait();
+    commit_close();
+    store_free();
+    remove(CSV_FILE);
+    remove(WAL_FILE);
+    remove(IDX_FILE);
+    remove(LOCK_FILE);
+    return 0;
+}
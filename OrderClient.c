@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Talks to `orders_app --serve`: each command goes out as one frame
+// (4-byte big-endian length + text), each reply comes back the same way.
+//   order_client [-s SOCKET] COMMAND...     one command from the arguments
+//   order_client [-s SOCKET] < commands     one command per input line
+// Input lines are pipelined: up to WINDOW commands leave in one writev before
+// the first reply is read, so a long script costs a round trip per window.
+// Exit code: 0 all replies OK, 1 some reply was ERR, 2 connection trouble.
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#define DEFAULT_SOCK "orders.csv.sock"
+#define MAX_FRAME    (1 << 24)
+#define WINDOW       64         // commands in flight; two iovecs each stays under IOV_MAX
+#define MAX_LINE     4096
+
+static int read_full(int fd, void *buf, size_t n) {
+    for (size_t got = 0; got < n; ) {
+        ssize_t r = read(fd, (char *)buf + got, n - got);
+        if (r <= 0) return 0;
+        got += (size_t)r;
+    }
+    return 1;
+}
+
+static void put_len(unsigned char h[4], size_t n) {
+    h[0] = (unsigned char)(n >> 24);
+    h[1] = (unsigned char)(n >> 16);
+    h[2] = (unsigned char)(n >> 8);
+    h[3] = (unsigned char)n;
+}
+
+// writev until every iovec is out; the array is consumed
+static int writev_full(int fd, struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t w = writev(fd, iov, cnt);
+        if (w <= 0) return 0;
+        while (cnt > 0 && (size_t)w >= iov->iov_len) { w -= (ssize_t)iov->iov_len; iov++; cnt--; }
+        if (cnt > 0) { iov->iov_base = (char *)iov->iov_base + w; iov->iov_len -= (size_t)w; }
+    }
+    return 1;
+}
+
+// print one reply; -1 on connection trouble, else 1 if OK
+static int recv_reply(int fd) {
+    unsigned char h[4];
+    if (!read_full(fd, h, 4)) return -1;
+    size_t len = (size_t)h[0] << 24 | (size_t)h[1] << 16 | (size_t)h[2] << 8 | h[3];
+    if (len > MAX_FRAME) return -1;
+    char *reply = malloc(len + 1);
+    if (!reply || !read_full(fd, reply, len)) { free(reply); return -1; }
+    reply[len] = '\0';
+    fputs(reply, stdout);
+    int ok = strncmp(reply, "OK", 2) == 0;
+    free(reply);
+    return ok;
+}
+
+// send n commands in one writev, then print their n replies in order;
+// -1 on connection trouble, else 1 if every reply was OK
+static int call_window(int fd, char cmd[][MAX_LINE], int n) {
+    unsigned char hdr[WINDOW][4];
+    struct iovec iov[2 * WINDOW];
+    for (int i = 0; i < n; ++i) {
+        size_t len = strlen(cmd[i]);
+        put_len(hdr[i], len);
+        iov[2 * i].iov_base = hdr[i];
+        iov[2 * i].iov_len = 4;
+        iov[2 * i + 1].iov_base = cmd[i];
+        iov[2 * i + 1].iov_len = len;
+    }
+    if (!writev_full(fd, iov, 2 * n)) return -1;
+    int ok = 1;
+    for (int i = 0; i < n; ++i) {
+        int r = recv_reply(fd);
+        if (r < 0) return -1;
+        if (!r) ok = 0;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *path = DEFAULT_SOCK;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) { path = argv[2]; first = 3; }
+
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof sa.sun_path) { fprintf(stderr, "%s: socket path too long\n", path); return 2; }
+    strcpy(sa.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sa, sizeof sa) != 0) { perror(path); return 2; }
+
+    int rc = 0, r;
+    if (first < argc) {
+        // arguments are joined back into one command line
+        static char cmd[1][MAX_LINE];
+        size_t len = 0;
+        for (int i = first; i < argc; ++i) {
+            int n = snprintf(cmd[0] + len, MAX_LINE - len, "%s%s", i > first ? " " : "", argv[i]);
+            if (n < 0 || (size_t)n >= MAX_LINE - len) { fprintf(stderr, "command too long\n"); close(fd); return 2; }
+            len += (size_t)n;
+        }
+        r = call_window(fd, cmd, 1);
+        rc = r < 0 ? 2 : !r;
+    } else {
+        static char cmd[WINDOW][MAX_LINE];
+        int n = 0, more = 1;
+        while (rc != 2 && more) {
+            more = fgets(cmd[n], MAX_LINE, stdin) != NULL;
+            if (more) {
+                cmd[n][strcspn(cmd[n], "\r\n")] = '\0';
+                if (!cmd[n][0] || cmd[n][0] == '#') continue;
+                if (++n < WINDOW) continue;
+            }
+            if (n == 0) continue;
+            r = call_window(fd, cmd, n);
+            n = 0;
+            if (r < 0) rc = 2;
+            else if (!r) rc = 1;
+        }
+    }
+    if (rc == 2) fprintf(stderr, "%s: connection lost\n", path);
+    close(fd);
+    fflush(stdout);
+    return rc;
+}
+#else
+int main(void) {
+    fprintf(stderr, "order_client needs Unix domain sockets\n");
+    return 2;
+}
+#endif
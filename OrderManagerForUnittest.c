@@ -1,579 +1,4608 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <ctype.h>
-#include <limits.h>
-#include <errno.h>
-
-#define CSV_FILE "Unittestorders.csv"
-#define UNIT_TESTING
-
-
-
-static void chomp(char *s) {
-    size_t n = strlen(s);
-    while (n && (s[n-1] == '\n' || s[n-1] == '\r')) s[--n] = '\0';
-}
-// keep CSV simple
-static void sanitize_commas(char *s) {
-    for (char *p = s; *p; ++p) if (*p == ',') *p = ' ';  
-}
-
-static void lowercase(char *s) {
-    for (; *s; ++s) *s = (char)tolower((unsigned char)*s);
-}
-
-static int line_starts_with_digit(const char *s) {
-    while (*s == ' ' || *s == '\t') s++;
-    return *s && isdigit((unsigned char)*s);
-}
-
-
-//CSV parse id,customer,product,qty,price,date
-static int parse_csv_line(const char *line,
-                          int *orderid, char *customer, char *product,
-                          int *qty, float *price, char *date) {
-    return sscanf(line, " %d , %49[^,] , %49[^,] , %d , %f , %19[^\n]",
-                  orderid, customer, product, qty, price, date) == 6;
-}
-
-// Basic DD-MM-YYYY validation
-static int is_valid_date_str(const char *s) {
-    int d, m, y;
-    if (sscanf(s, "%2d-%2d-%4d", &d, &m, &y) != 3) return 0;
-    if (y < 1999 || y > 2025) return 0;
-    if (m < 1 || m > 12) return 0;
-    int mdays[] = {0,31,28,31,30,31,30,31,31,30,31,30,31};
-    int leap = ( (y%4==0 && y%100!=0) || (y%400==0) );
-    if (leap) mdays[2] = 29;
-    if (d < 1 || d > mdays[m]) return 0;
-    return 1;
-}
-
-// Safe input (loops until valid)
-
-static void read_line(const char *prompt, char *buf, size_t cap) {
-    for (;;) {
-        if (prompt && *prompt) printf("%s", prompt);
-        if (!fgets(buf, cap, stdin)) { clearerr(stdin); continue; }
-        chomp(buf);
-        return;
-    }
-}
-//parse int prevent overflow
-int try_parse_int(const char* s, int* out) {
-    if (!s || !*s || !out) return 0;
-
-    // Disallow leading whitespace to match the test’s stricter behavior
-    if (isspace((unsigned char)*s)) return 0;
-
-    errno = 0;
-    char *end = NULL;
-    long v = strtol(s, &end, 10);   // base 10 only
-
-    // must consume the whole string; no trailing chars or spaces
-    if (s == end || *end != '\0') return 0;
-
-    // overflow/underflow
-    if (errno == ERANGE || v < INT_MIN || v > INT_MAX) return 0;
-
-    *out = (int)v;
-    return 1;
-}
-
-static int try_parse_float(const char *s, float *out) {
-    if (!s || !*s) return 0;
-    char *end = NULL;
-    double v = strtod(s, &end);
-    if (end == s || *end != '\0') return 0;
-    if (v < -1e30 || v > 1e30) return 0; // arbitrary big guard
-    *out = (float)v;
-    return 1;
-}
-
-//loops until a valid integer
-static int read_int_loop(const char *prompt, int *out, int enforce_min, int minval) {
-    char buf[128];
-    for (;;) {
-        read_line(prompt, buf, sizeof buf);
-        if (try_parse_int(buf, out) && (!enforce_min || *out >= minval)) return 1;
-        if (enforce_min)
-            printf("Invalid input. Please enter an integer >= %d.\n", minval);
-        else
-            printf("Invalid input. Please enter an integer.\n");
-    }
-}
-
-//loops until a valid float
-static int read_float_loop(const char *prompt, float *out, int enforce_min, float minval) {
-    char buf[128];
-    for (;;) {
-        read_line(prompt, buf, sizeof buf);
-        if (try_parse_float(buf, out) && (!enforce_min || *out >= minval)) return 1;
-        if (enforce_min)
-            printf("Invalid input. Please enter a number >= %.2f.\n", minval);
-        else
-            printf("Invalid input. Please enter a number.\n");
-    }
-}
-
-//loops until non-empty text; disallows commas
-static void read_text_loop(const char *prompt, char *out, size_t cap) {
-    for (;;) {
-        read_line(prompt, out, cap);
-        sanitize_commas(out);
-        if (out[0] != '\0') return;
-        printf("Input cannot be empty.\n");
-    }
-}
-
-//optional versions for update (blank = keep)
-static int read_optional_int(const char *prompt, int *out_value) {
-    char buf[128];
-    read_line(prompt, buf, sizeof buf);
-    if (buf[0] == '\0') return 0; // keep
-    int v;
-    if (!try_parse_int(buf, &v)) { printf("Not a valid integer. Keeping old value.\n"); return 0; }
-    *out_value = v; return 1;
-}
-
-static int read_optional_float(const char *prompt, float *out_value) {
-    char buf[128];
-    read_line(prompt, buf, sizeof buf);
-    if (buf[0] == '\0') return 0;
-    float v;
-    if (!try_parse_float(buf, &v)) { printf("Not a valid number. Keeping old value.\n"); return 0; }
-    *out_value = v; return 1;
-}
-
-static int read_optional_text(const char *prompt, char *dst, size_t cap) {
-    char buf[256];
-    read_line(prompt, buf, sizeof buf);
-    if (buf[0] == '\0') return 0;
-    sanitize_commas(buf);
-    strncpy(dst, buf, cap - 1); dst[cap - 1] = '\0';
-    return 1;
-}
-
-//date with loop
-static void read_date_loop(const char *prompt, char *dst, size_t cap) {
-    for (;;) {
-        read_line(prompt, dst, cap);
-        if (is_valid_date_str(dst)) return;
-        printf("Invalid date. Use DD-MM-YYYY , 0x not allow use x instead and a real calendar date.\n");
-    }
-}
-
-static int read_optional_date(const char *prompt, char *dst, size_t cap) {
-    char buf[64];
-    read_line(prompt, buf, sizeof buf);
-    if (buf[0] == '\0') return 0;
-    if (!is_valid_date_str(buf)) { printf("Invalid date. Keeping old value.\n"); return 0; }
-    strncpy(dst, buf, cap - 1); dst[cap - 1] = '\0';
-    return 1;
-}
-
-/* CSV file helpers  */
-
-static void ensure_csv_header(void) {
-    FILE *f = fopen(CSV_FILE, "r");
-    if (!f) {
-        FILE *w = fopen(CSV_FILE, "w");
-        if (w) {
-            fputs("orderid,customername,productname,quantity,price,orderdate\n", w);
-            fclose(w);
-        }
-        return;
-    }
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fclose(f);
-    if (size == 0) {
-        FILE *w = fopen(CSV_FILE, "w");
-        if (w) {
-            fputs("orderid,customername,productname,quantity,price,orderdate\n", w);
-            fclose(w);
-        }
-    }
-}
-
-static int orderIDExists(int target) {
-    FILE *f = fopen(CSV_FILE, "r");
-    if (!f) return 0;
-
-    char line[512];
-    long pos = ftell(f);
-    if (fgets(line, sizeof line, f)) {
-        if (line_starts_with_digit(line)) fseek(f, pos, SEEK_SET);
-    } else { fclose(f); return 0; }
-
-    while (fgets(line, sizeof line, f)) {
-        int id, qty; float price;
-        char customer[50], product[50], date[20];
-        if (!parse_csv_line(line, &id, customer, product, &qty, &price, date)) continue;
-        if (id == target) { fclose(f); return 1; }
-    }
-    fclose(f);
-    return 0;
-}
-
-/* Features */
-
-static void Addcsv(void) {
-    ensure_csv_header();
-
-    int id, qty;
-    float price;
-    char customer[50], product[50], date[20];
-
-    // unique id
-    for (;;) {
-        read_int_loop("Enter Order ID: ", &id, 0, 0);
-        if (!orderIDExists(id)) break;
-        printf("Order ID %d already exists. Try another.\n", id);
-    }
-
-    //valid data type
-    read_text_loop("Customer name: ", customer, sizeof customer);
-    read_text_loop("Product name: ",  product,  sizeof product);
-    read_int_loop ("Quantity (>=0): ", &qty, 1, 0);
-    read_float_loop("Price (>=0): ", &price, 1, 0.0f);
-    read_date_loop ("Order date (DD-MM-YYYY): ", date, sizeof date);
-
-    FILE *f = fopen(CSV_FILE, "a");
-    if (!f) { perror(CSV_FILE); return; }
-    fprintf(f, "%d,%s,%s,%d,%.2f,%s\n", id, customer, product, qty, price, date);
-    fclose(f);
-    printf("Added: %d,%s,%s,%d,%.2f,%s\n", id, customer, product, qty, price, date);
-}
-
-static void searchByOrderID(void) {
-    FILE *file = fopen(CSV_FILE, "r");
-    if (!file) { perror(CSV_FILE); return; }
-
-    int id;
-    read_int_loop("Enter Order ID to search: ", &id, 0, 0);
-
-    char line[512];
-    int found = 0;
-
-    long pos = ftell(file);
-    if (fgets(line, sizeof line, file)) {
-        if (line_starts_with_digit(line)) fseek(file, pos, SEEK_SET);
-    } else { fclose(file); printf("No data.\n"); return; }
-
-    while (fgets(line, sizeof line, file)) {
-        int orderid, qty; float price;
-        char customer[50], product[50], date[20];
-        if (!parse_csv_line(line, &orderid, customer, product, &qty, &price, date)) continue;
-
-        if (orderid == id) {
-            printf("Found: %d, %s, %s, %d, %.2f, %s\n",
-                   orderid, customer, product, qty, price, date);
-            found = 1;
-            break;
-        }
-    }
-    if (!found) printf("OrderID %d not found.\n", id);
-    fclose(file);
-}
-
-static void searchByProductName(void) {
-    FILE *file = fopen(CSV_FILE, "r");
-    if (!file) { perror(CSV_FILE); return; }
-
-    char needle[64];
-    read_text_loop("Enter product name (substring, case-insensitive): ", needle, sizeof needle);
-
-    char needle_lc[64];
-    strncpy(needle_lc, needle, sizeof needle_lc - 1);
-    needle_lc[sizeof needle_lc - 1] = '\0';
-    lowercase(needle_lc);
-
-    char line[512];
-    int printed_header = 0, matches = 0;
-
-    long pos = ftell(file);
-    if (fgets(line, sizeof line, file)) {
-        if (line_starts_with_digit(line)) fseek(file, pos, SEEK_SET);
-    } else { fclose(file); printf("No data.\n"); return; }
-
-    while (fgets(line, sizeof line, file)) {
-        int orderid, qty; float price;
-        char customer[50], product[50], date[20];
-        if (!parse_csv_line(line, &orderid, customer, product, &qty, &price, date)) continue;
-
-        char product_lc[50];
-        strncpy(product_lc, product, sizeof product_lc - 1);
-        product_lc[sizeof product_lc - 1] = '\0';
-        lowercase(product_lc);
-
-        if (strstr(product_lc, needle_lc)) {
-            if (!printed_header) {
-                printf("Matches for \"%s\":\n", needle);
-                printed_header = 1;
-            }
-            printf("%d, %s, %s, %d, %.2f, %s\n",
-                   orderid, customer, product, qty, price, date);
-            matches++;
-        }
-    }
-
-    if (!matches) printf("No orders found for product containing \"%s\".\n", needle);
-    fclose(file);
-}
-
-static void updateOrderByID(void) {
-    FILE *in = fopen(CSV_FILE, "r");
-    if (!in) { perror(CSV_FILE); return; }
-
-    FILE *out = fopen("orders.tmp", "w");
-    if (!out) { perror("orders.tmp"); fclose(in); return; }
-
-    int target;
-    read_int_loop("Enter Order ID to update: ", &target, 0, 0);
-
-    char line[512];
-    int found = 0;
-
-    long pos = ftell(in);
-    if (fgets(line, sizeof line, in)) {
-        if (!line_starts_with_digit(line)) {
-            fputs(line, out); /* copy header */
-        } else {
-            fseek(in, pos, SEEK_SET);
-        }
-    } else { printf("File is empty.\n"); fclose(in); fclose(out); remove("orders.tmp"); return; }
-
-    while (fgets(line, sizeof line, in)) {
-        int orderid, qty; float price;
-        char customer[50], product[50], date[20];
-
-        if (!parse_csv_line(line, &orderid, customer, product, &qty, &price, date)) {
-            fputs(line, out); /* preserve unknown lines */
-            continue;
-        }
-
-        if (orderid == target) {
-            found = 1;
-            printf("Current: %d, %s, %s, %d, %.2f, %s\n",
-                   orderid, customer, product, qty, price, date);
-
-            //optional edits
-            if (read_optional_text ("New customer name (leave blank to keep): ", customer, sizeof customer)) { /* ok */ }
-            if (read_optional_text ("New product name  (leave blank to keep): ", product,  sizeof product))  { /* ok */ }
-
-            int new_qty;
-            if (read_optional_int("New quantity (leave blank to keep): ", &new_qty)) {
-                if (new_qty < 0) printf("Quantity must be >= 0. Keeping old value.\n");
-                else qty = new_qty;
-            }
-
-            float new_price;
-            if (read_optional_float("New price (leave blank to keep): ", &new_price)) {
-                if (new_price < 0.f) printf("Price must be >= 0. Keeping old value.\n");
-                else price = new_price;
-            }
-
-            if (read_optional_date("New order date DD-MM-YYYY (leave blank to keep): ", date, sizeof date)) { /* ok */ }
-
-            fprintf(out, "%d,%s,%s,%d,%.2f,%s\n",
-                    orderid, customer, product, qty, price, date);
-        } else {
-            fputs(line, out);
-        }
-    }
-
-    fclose(in);
-    if (fclose(out) != 0) { perror("close tmp"); remove("orders.tmp"); return; }
-
-    if (!found) {
-        printf("OrderID %d not found. No changes made.\n", target);
-        remove("orders.tmp");
-        return;
-    }
-
-    if (remove(CSV_FILE) != 0) { perror("remove original"); remove("orders.tmp"); return; }
-    if (rename("orders.tmp", CSV_FILE) != 0) { perror("rename tmp->csv"); return; }
-
-    printf("Order %d updated successfully.\n", target);
-}
-
-
-static void deleteByOrderID(void) {
-    FILE *in = fopen(CSV_FILE, "r");
-    if (!in) { perror(CSV_FILE); return; }
-
-    int target;
-    read_int_loop("Enter Order ID to delete: ", &target, 0, 0);
-
-    // First pass: collect matches so user can choose which one to delete 
-    char line[512];
-    int has_header = 0;
-    int matches = 0;
-
-    //Peek header
-    long pos = ftell(in);
-    if (fgets(line, sizeof line, in)) {
-        if (!line_starts_with_digit(line)) has_header = 1;
-        else fseek(in, pos, SEEK_SET);
-    } else { fclose(in); printf("No data.\n"); return; }
-
-    // We’ll store a small snapshot of matches for display 
-    typedef struct {
-        int orderid, qty;
-        float price;
-        char customer[50], product[50], date[20];
-    } Row;
-    Row found[1024];
-
-    while (fgets(line, sizeof line, in)) {
-        int orderid, qty; float price;
-        char customer[50], product[50], date[20];
-        if (!parse_csv_line(line, &orderid, customer, product, &qty, &price, date)) continue;
-        if (orderid == target) {
-            if (matches < (int)(sizeof found / sizeof found[0])) {
-                found[matches].orderid = orderid;
-                found[matches].qty = qty;
-                found[matches].price = price;
-                strncpy(found[matches].customer, customer, sizeof found[matches].customer - 1);
-                found[matches].customer[sizeof found[matches].customer - 1] = '\0';
-                strncpy(found[matches].product, product, sizeof found[matches].product - 1);
-                found[matches].product[sizeof found[matches].product - 1] = '\0';
-                strncpy(found[matches].date, date, sizeof found[matches].date - 1);
-                found[matches].date[sizeof found[matches].date - 1] = '\0';
-            }
-            matches++;
-        }
-    }
-
-    if (matches == 0) {
-        fclose(in);
-        printf("OrderID %d not found. Nothing to delete.\n", target);
-        return;
-    }
-
-    printf("\nFound %d record(s) with OrderID %d:\n", matches, target);
-    for (int i = 0; i < matches && i < 1024; ++i) {
-        printf("  [%d] %d, %s, %s, %d, %.2f, %s\n",
-               i + 1,
-               found[i].orderid, found[i].customer, found[i].product,
-               found[i].qty, found[i].price, found[i].date);
-    }
-    if (matches > 1024) {
-        printf("  ...and %d more (only first 1024 shown)\n", matches - 1024);
-    }
-
-    // Choose which matching line to delete
-    int choice_index = 1;
-    if (matches > 1) {
-        for (;;) {
-            if (read_int_loop("Choose which one to delete [1..N]: ", &choice_index, 1, 1)) {
-                if (choice_index >= 1 && choice_index <= matches) break;
-            }
-            printf("Please choose a number between 1 and %d.\n", matches);
-        }
-    }
-
-    // Confirm deletion 
-    char confirm[16];
-    read_line("Confirm delete? (Y/N): ", confirm, sizeof confirm);
-    if (!(confirm[0] == 'Y' || confirm[0] == 'y')) {
-        fclose(in);
-        printf("Canceled. No changes made.\n");
-        return;
-    }
-
-    /* Second pass: write everything except the selected occurrence of that OrderID */
-    FILE *out = fopen("orders.tmp", "w");
-    if (!out) { perror("orders.tmp"); fclose(in); return; }
-
-    rewind(in);
-    int current_match_idx = 0;
-
-    /* Copy header if present */
-    if (has_header && fgets(line, sizeof line, in)) {
-        fputs(line, out);
-    } else {
-        /* If no header was present, ensure we start at beginning */
-        if (!has_header) rewind(in);
-    }
-
-    while (fgets(line, sizeof line, in)) {
-        int orderid, qty; float price;
-        char customer[50], product[50], date[20];
-
-        if (!parse_csv_line(line, &orderid, customer, product, &qty, &price, date)) {
-            fputs(line, out);  /* keep unparsable lines */
-            continue;
-        }
-
-        if (orderid == target) {
-            current_match_idx++;
-            if (current_match_idx == choice_index) {
-                /* Skip writing this one = delete */
-                continue;
-            }
-        }
-        fputs(line, out);
-    }
-
-    fclose(in);
-    if (fclose(out) != 0) { perror("close tmp"); remove("orders.tmp"); return; }
-
-    if (remove(CSV_FILE) != 0) { perror("remove original"); remove("orders.tmp"); return; }
-    if (rename("orders.tmp", CSV_FILE) != 0) { perror("rename tmp->csv"); return; }
-
-    printf("Deleted record [%d] for OrderID %d successfully.\n", choice_index, target);
-}
-
-
-/*  Menu  */
-
-static int read_menu_choice(int minc, int maxc) {
-    char buf[64];
-    int c;
-    for (;;) {
-        read_line("Choose: ", buf, sizeof buf);
-        if (try_parse_int(buf, &c) && c >= minc && c <= maxc) return c;
-        printf("Please enter a number between %d and %d.\n", minc, maxc);
-    }
-}
-
-static void searchMenu(void) {
-    for (;;) {
-        printf("\n-- Search Menu --\n");
-        printf("[1] By Order ID\n");
-        printf("[2] By Product Name\n");
-        printf("[3] Back\n");
-        int choice = read_menu_choice(1, 3);
-        if (choice == 1)      searchByOrderID();
-        else if (choice == 2) searchByProductName();
-        else break;
-    }
-}
-
-//main
-#ifndef UNIT_TESTING
-int main(void) {
-    ensure_csv_header();
-
-    for (;;) {
-        printf("\n==== Orders CSV App (safe input) ====\n");
-        printf("[1] Add order\n");
-        printf("[2] Search\n");
-        printf("[3] Update by ID\n");
-        printf("[4] Delete by ID\n");
-        printf("[5] Exit\n");
-        int choice = read_menu_choice(1, 5);
-
-        switch (choice) {
-            case 1: Addcsv(); break;
-            case 2: searchMenu(); break;
-            case 3: updateOrderByID(); break;
-            case 4: deleteByOrderID(); break;
-            case 5: printf("End of program\n"); return 0;
-        }
-    }
-}
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#endif
+#ifdef __linux__
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FOLD_SIMD 1
+#include <immintrin.h>
+#endif
+
+#ifndef CSV_FILE
+#define CSV_FILE "Unittestorders.csv"
+#endif
+#define UNIT_TESTING
+#define IDX_FILE CSV_FILE ".idx"
+#define WAL_FILE CSV_FILE ".wal"
+#define SOCK_FILE CSV_FILE ".sock"
+#define LOCK_FILE CSV_FILE ".lock"
+
+// background compaction kicks in past either threshold
+#define COMPACT_WAL_BYTES   (8L << 20)
+#define COMPACT_TOMB_RATIO  0.25
+#define COMPACT_MIN_TOMBS   1024
+
+
+
+static void chomp(char *s) {
+    size_t n = strlen(s);
+    while (n && (s[n-1] == '\n' || s[n-1] == '\r')) s[--n] = '\0';
+}
+// keep CSV simple
+static void sanitize_commas(char *s) {
+    for (char *p = s; *p; ++p) if (*p == ',') *p = ' ';  
+}
+
+static void lowercase(char *s) {
+    for (; *s; ++s) *s = (char)tolower((unsigned char)*s);
+}
+
+static int line_starts_with_digit(const char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    return *s && isdigit((unsigned char)*s);
+}
+
+
+/* CSV tokenizer: one pass, fields stay slices of the line until a row is used */
+
+// accepts exactly what sscanf(" %d , %49[^,] , %49[^,] , %d , %f , %19[^\n]") did
+typedef struct {
+    int orderid, qty;
+    float price;
+    const char *customer, *product, *date;
+    size_t customer_len, product_len, date_len;
+} CsvRow;
+
+static int is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static const char *skip_space(const char *p, const char *end) {
+    while (p < end && is_space(*p)) p++;
+    return p;
+}
+
+// leading digits of p as a number, 8 at a time where the bytes are there
+static const char *scan_digits(const char *p, const char *end, uint64_t *out) {
+    uint64_t v = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - p >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        x -= 0x3030303030303030ULL;
+        // high bit set in every byte that is not '0'..'9'
+        uint64_t bad = (x | (x + 0x7676767676767676ULL)) & 0x8080808080808080ULL;
+        int n = bad ? __builtin_ctzll(bad) >> 3 : 8;
+        if (n == 0) break;
+        x <<= 8 * (8 - n);  // keep the n digits, zeros in front
+        x = (x * 10) + (x >> 8);
+        x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+           + (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+        static const uint64_t pow10[9] = {1,10,100,1000,10000,100000,1000000,10000000,100000000};
+        v = v * pow10[n] + x;
+        p += n;
+        if (n < 8) { *out = v; return p; }
+    }
+#endif
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (uint64_t)(*p++ - '0');
+    *out = v;
+    return p;
+}
+
+static const char *scan_int(const char *p, const char *end, int *out) {
+    p = skip_space(p, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    uint64_t v;
+    const char *q = scan_digits(p, end, &v);
+    if (q == p) return NULL;
+    *out = (int)(neg ? -(long long)v : (long long)v);
+    return q;
+}
+
+static const char *scan_float(const char *p, const char *end, float *out) {
+    p = skip_space(p, end);
+    const char *s = p;
+    int neg = 0;
+    if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+
+    // fast path: digits with up to two decimals, small enough that one float
+    // division rounds exactly like strtof
+    uint64_t ip, fp = 0;
+    const char *q = scan_digits(s, end, &ip);
+    int nfrac = 0;
+    if (q > s && q < end && *q == '.') {
+        const char *f = q + 1;
+        while (f < end && nfrac < 3 && *f >= '0' && *f <= '9') { fp = fp * 10 + (uint64_t)(*f++ - '0'); nfrac++; }
+        q = f;
+    }
+    if (q > s && nfrac <= 2 && ip < 100000 && (q == end || !(isalnum((unsigned char)*q) || *q == '.'))) {
+        float v = nfrac == 0 ? (float)ip
+                : nfrac == 1 ? (float)(ip * 10 + fp) / 10.0f
+                             : (float)(ip * 100 + fp) / 100.0f;
+        *out = neg ? -v : v;
+        return q;
+    }
+
+    // everything else (exponents, inf/nan, long fractions) goes through strtof
+    char buf[64];
+    size_t n = 0;
+    while (p + n < end && n < sizeof buf - 1 && p[n] != ',' && p[n] != '\n') n++;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    char *e;
+    float v = strtof(buf, &e);
+    if (e == buf) return NULL;
+
+    // scanf cannot push back more than one byte: "0x" needs digits, and a
+    // dangling exponent marker (plus its sign) is swallowed
+    const char *b = buf + (*buf == '-' || *buf == '+');
+    int hex = b[0] == '0' && (b[1] == 'x' || b[1] == 'X');
+    if (hex && e == b + 1) {
+        if (b[2] != '.') return NULL;
+        e = (char *)b + 3;
+    } else if (strpbrk(buf, "0123456789") && strpbrk(buf, "0123456789") < e
+               && memchr(buf, hex ? 'p' : 'e', (size_t)(e - buf)) == NULL
+               && memchr(buf, hex ? 'P' : 'E', (size_t)(e - buf)) == NULL
+               && (hex ? (*e == 'p' || *e == 'P') : (*e == 'e' || *e == 'E'))) {
+        e++;
+        if (*e == '+' || *e == '-') e++;
+    }
+    *out = v;
+    return p + (e - buf);
+}
+
+// %N[^stop]: 1..max bytes up to stop
+static const char *scan_field(const char *p, const char *end, char stop, size_t max,
+                              const char **field, size_t *len) {
+    p = skip_space(p, end);
+    size_t n = 0;
+    while (p + n < end && n < max && p[n] != stop) n++;
+    if (n == 0) return NULL;
+    *field = p;
+    *len = n;
+    return p + n;
+}
+
+static const char *expect_comma(const char *p, const char *end) {
+    p = skip_space(p, end);
+    return (p < end && *p == ',') ? p + 1 : NULL;
+}
+
+static int csv_tokenize(const char *line, size_t len, CsvRow *r) {
+    const char *p = line, *end = line + len;
+    if (!(p = scan_int(p, end, &r->orderid)) || !(p = expect_comma(p, end))) return 0;
+    if (!(p = scan_field(p, end, ',', 49, &r->customer, &r->customer_len)) || !(p = expect_comma(p, end))) return 0;
+    if (!(p = scan_field(p, end, ',', 49, &r->product, &r->product_len)) || !(p = expect_comma(p, end))) return 0;
+    if (!(p = scan_int(p, end, &r->qty)) || !(p = expect_comma(p, end))) return 0;
+    if (!(p = scan_float(p, end, &r->price)) || !(p = expect_comma(p, end))) return 0;
+    return scan_field(p, end, '\n', 19, &r->date, &r->date_len) != NULL;
+}
+
+static void copy_field(char *dst, const char *src, size_t n) {
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+//CSV parse id,customer,product,qty,price,date (string form, kept for the tests and the benchmark)
+#ifdef UNIT_TESTING
+static int parse_csv_line(const char *line,
+                          int *orderid, char *customer, char *product,
+                          int *qty, float *price, char *date) {
+    CsvRow r;
+    if (!csv_tokenize(line, strlen(line), &r)) return 0;
+    *orderid = r.orderid;
+    *qty = r.qty;
+    *price = r.price;
+    copy_field(customer, r.customer, r.customer_len);
+    copy_field(product, r.product, r.product_len);
+    copy_field(date, r.date, r.date_len);
+    return 1;
+}
+#endif
+
+/* Dates: stored packed as yyyymmdd, turned into text only for output */
+
+static const unsigned char month_days[13] = {0,31,28,31,30,31,30,31,31,30,31,30,31};
+
+// %<width>d the way scanf reads it: blanks skipped, sign counts toward width
+static const char *scan_width_int(const char *p, const char *end, int width, int *out) {
+    p = skip_space(p, end);
+    int neg = 0, v = 0, nd = 0;
+    if (p < end && (*p == '-' || *p == '+')) { neg = *p++ == '-'; width--; }
+    for (; p < end && width > 0 && *p >= '0' && *p <= '9'; ++p, --width, ++nd) v = v * 10 + (*p - '0');
+    if (!nd) return NULL;
+    *out = neg ? -v : v;
+    return p;
+}
+
+// DD-MM-YYYY (read like "%2d-%2d-%4d") -> yyyymmdd, 0 unless a real calendar date
+static uint32_t date_pack(const char *s, size_t n) {
+    const char *p = s, *end = s + n;
+    int d, m, y;
+    if (!(p = scan_width_int(p, end, 2, &d)) || p == end || *p++ != '-') return 0;
+    if (!(p = scan_width_int(p, end, 2, &m)) || p == end || *p++ != '-') return 0;
+    if (!scan_width_int(p, end, 4, &y)) return 0;
+    if (y < 1 || (unsigned)(m - 1) > 11u || d < 1) return 0;
+    unsigned leap = (y % 4 == 0) & ((y % 100 != 0) | (y % 400 == 0));
+    if ((unsigned)d > month_days[m] + (m == 2) * leap) return 0;
+    return (uint32_t)(y * 10000 + m * 100 + d);
+}
+
+static void date_format(uint32_t date, char *buf, size_t cap) {
+    snprintf(buf, cap, "%02u-%02u-%04u",
+             (unsigned)(date % 100), (unsigned)(date / 100 % 100), (unsigned)(date / 10000));
+}
+
+// Basic DD-MM-YYYY validation
+static int is_valid_date_str(const char *s) {
+    uint32_t d = date_pack(s, strlen(s));
+    return d >= 19990101u && d <= 20251231u;
+}
+
+// Safe input (loops until valid)
+
+static void read_line(const char *prompt, char *buf, size_t cap) {
+    for (;;) {
+        if (prompt && *prompt) printf("%s", prompt);
+        if (!fgets(buf, cap, stdin)) { clearerr(stdin); continue; }
+        chomp(buf);
+        return;
+    }
+}
+//parse int prevent overflow
+int try_parse_int(const char* s, int* out) {
+    if (!s || !*s || !out) return 0;
+
+    // Disallow leading whitespace to match the test’s stricter behavior
+    if (isspace((unsigned char)*s)) return 0;
+
+    errno = 0;
+    char *end = NULL;
+    long v = strtol(s, &end, 10);   // base 10 only
+
+    // must consume the whole string; no trailing chars or spaces
+    if (s == end || *end != '\0') return 0;
+
+    // overflow/underflow
+    if (errno == ERANGE || v < INT_MIN || v > INT_MAX) return 0;
+
+    *out = (int)v;
+    return 1;
+}
+
+static int try_parse_float(const char *s, float *out) {
+    if (!s || !*s) return 0;
+    char *end = NULL;
+    double v = strtod(s, &end);
+    if (end == s || *end != '\0') return 0;
+    if (v < -1e30 || v > 1e30) return 0; // arbitrary big guard
+    *out = (float)v;
+    return 1;
+}
+
+//loops until a valid integer
+static int read_int_loop(const char *prompt, int *out, int enforce_min, int minval) {
+    char buf[128];
+    for (;;) {
+        read_line(prompt, buf, sizeof buf);
+        if (try_parse_int(buf, out) && (!enforce_min || *out >= minval)) return 1;
+        if (enforce_min)
+            printf("Invalid input. Please enter an integer >= %d.\n", minval);
+        else
+            printf("Invalid input. Please enter an integer.\n");
+    }
+}
+
+//loops until a valid float
+static int read_float_loop(const char *prompt, float *out, int enforce_min, float minval) {
+    char buf[128];
+    for (;;) {
+        read_line(prompt, buf, sizeof buf);
+        if (try_parse_float(buf, out) && (!enforce_min || *out >= minval)) return 1;
+        if (enforce_min)
+            printf("Invalid input. Please enter a number >= %.2f.\n", minval);
+        else
+            printf("Invalid input. Please enter a number.\n");
+    }
+}
+
+//loops until non-empty text; disallows commas
+static void read_text_loop(const char *prompt, char *out, size_t cap) {
+    for (;;) {
+        read_line(prompt, out, cap);
+        sanitize_commas(out);
+        if (out[0] != '\0') return;
+        printf("Input cannot be empty.\n");
+    }
+}
+
+//optional versions for update (blank = keep)
+static int read_optional_int(const char *prompt, int *out_value) {
+    char buf[128];
+    read_line(prompt, buf, sizeof buf);
+    if (buf[0] == '\0') return 0; // keep
+    int v;
+    if (!try_parse_int(buf, &v)) { printf("Not a valid integer. Keeping old value.\n"); return 0; }
+    *out_value = v; return 1;
+}
+
+static int read_optional_float(const char *prompt, float *out_value) {
+    char buf[128];
+    read_line(prompt, buf, sizeof buf);
+    if (buf[0] == '\0') return 0;
+    float v;
+    if (!try_parse_float(buf, &v)) { printf("Not a valid number. Keeping old value.\n"); return 0; }
+    *out_value = v; return 1;
+}
+
+static int read_optional_text(const char *prompt, char *dst, size_t cap) {
+    char buf[256];
+    read_line(prompt, buf, sizeof buf);
+    if (buf[0] == '\0') return 0;
+    sanitize_commas(buf);
+    strncpy(dst, buf, cap - 1); dst[cap - 1] = '\0';
+    return 1;
+}
+
+//date with loop
+static void read_date_loop(const char *prompt, char *dst, size_t cap) {
+    for (;;) {
+        read_line(prompt, dst, cap);
+        if (is_valid_date_str(dst)) return;
+        printf("Invalid date. Use DD-MM-YYYY , 0x not allow use x instead and a real calendar date.\n");
+    }
+}
+
+static int read_optional_date(const char *prompt, char *dst, size_t cap) {
+    char buf[64];
+    read_line(prompt, buf, sizeof buf);
+    if (buf[0] == '\0') return 0;
+    if (!is_valid_date_str(buf)) { printf("Invalid date. Keeping old value.\n"); return 0; }
+    strncpy(dst, buf, cap - 1); dst[cap - 1] = '\0';
+    return 1;
+}
+
+/* Advisory locks shared by every process using the same CSV */
+
+// fcntl byte locks in LOCK_FILE: one byte guards the data files (shared while
+// reading them, exclusive while appending or swapping), another is held by
+// the one process writing orders.tmp. The file's first 8 bytes count swaps.
+#define LK_NONE   0
+#define LK_SHARED 1
+#define LK_EXCL   2
+
+#define LOCK_DATA    0
+#define LOCK_COMPACT 1
+
+static int lock_fd = -1;    // never closed: closing any descriptor of the file drops our locks
+
+static int lock_range(int kind, long at, int wait) {
+#ifndef _WIN32
+    if (lock_fd < 0 && (lock_fd = open(LOCK_FILE, O_RDWR | O_CREAT, 0644)) < 0) { perror(LOCK_FILE); return 0; }
+    struct flock fl;
+    memset(&fl, 0, sizeof fl);
+    fl.l_type = kind == LK_EXCL ? F_WRLCK : kind == LK_SHARED ? F_RDLCK : F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = at;
+    fl.l_len = 1;
+    while (fcntl(lock_fd, wait ? F_SETLKW : F_SETLK, &fl) != 0) {
+        if (errno == EINTR) continue;
+        if (!wait && (errno == EACCES || errno == EAGAIN)) return 0;
+        perror(LOCK_FILE);
+        return 0;
+    }
+#else
+    (void)kind; (void)at; (void)wait;
+#endif
+    return 1;
+}
+
+static int store_locked = LK_NONE;     // what this process holds on the data range
+
+static int store_lock(int kind) {
+    if (!lock_range(kind, LOCK_DATA, 1)) return 0;
+    store_locked = kind;
+    return 1;
+}
+
+static void store_unlock(void) {
+    lock_range(LK_NONE, LOCK_DATA, 1);
+    store_locked = LK_NONE;
+}
+
+// bumped under the exclusive lock whenever the CSV is swapped and rows renumbered
+static uint64_t lock_gen(void) {
+    uint64_t g = 0;
+#ifndef _WIN32
+    if (lock_fd < 0 || pread(lock_fd, &g, sizeof g, 0) != (ssize_t)sizeof g) g = 0;
+#endif
+    return g;
+}
+
+static uint64_t lock_gen_bump(void) {
+    uint64_t g = lock_gen() + 1;
+#ifndef _WIN32
+    if (pwrite(lock_fd, &g, sizeof g, 0) != (ssize_t)sizeof g) perror(LOCK_FILE);
+#endif
+    return g;
+}
+
+/* Operation statistics: a latency histogram per operation and a few
+   counters, shown by the Stats menu and written by --stats-json at exit.
+   Build with -DNO_STATS to compile every probe out. */
+
+enum { OP_ADD, OP_GET, OP_FIND, OP_RANGE, OP_UPDATE, OP_DELETE,
+       OP_IMPORT, OP_LOAD, OP_CHECKPOINT, OP_COMPACT, OP_COUNT };
+enum { CT_ROWS_SCANNED, CT_ROWS_MATCHED, CT_BYTES_READ, CT_BYTES_WRITTEN, CT_REWRITES, CT_COUNT };
+
+static const char *const stat_op_names[OP_COUNT] = {
+    "add", "get", "find", "date_range", "update", "delete", "import", "load", "checkpoint", "compaction"
+};
+static const char *const stat_counter_names[CT_COUNT] = {
+    "rows_scanned", "rows_matched", "bytes_read", "bytes_written", "rewrites"
+};
+
+static const char *stats_json_path;     // --stats-json FILE
+
+// monotonic nanoseconds, for the stats and the trace spans
+static uint64_t stat_clock(void) {
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000u / CLOCKS_PER_SEC);
+#endif
+}
+
+#ifndef NO_STATS
+// log-linear buckets as in HDR histograms: exact below STAT_SUB ns, then
+// STAT_SUB buckets per power of two, so a bucket is within 1/16 of its values
+#define STAT_SUB     16
+#define STAT_BUCKETS (37 * STAT_SUB)    // up to 2^40 ns, about 18 minutes
+
+typedef struct {
+    uint64_t count, sum_ns, max_ns;
+    uint64_t bucket[STAT_BUCKETS];
+} StatHist;
+
+static StatHist stat_ops[OP_COUNT];
+static uint64_t stat_counters[CT_COUNT];
+
+static unsigned stat_bucket(uint64_t ns) {
+    if (ns < STAT_SUB) return (unsigned)ns;
+    unsigned msb = 0;
+    for (uint64_t v = ns; v > 1; v >>= 1) msb++;
+    unsigned b = (msb - 3) * STAT_SUB + (unsigned)((ns >> (msb - 4)) & (STAT_SUB - 1));
+    return b < STAT_BUCKETS ? b : STAT_BUCKETS - 1;
+}
+
+// largest value that lands in bucket b
+static uint64_t stat_bucket_top(unsigned b) {
+    if (b < STAT_SUB) return b;
+    unsigned msb = b / STAT_SUB + 3;
+    return ((uint64_t)(STAT_SUB + b % STAT_SUB + 1) << (msb - 4)) - 1;
+}
+
+// any thread: daemon loops record reads concurrently
+static void stat_record(int op, uint64_t ns) {
+    StatHist *h = &stat_ops[op];
+    __atomic_fetch_add(&h->bucket[stat_bucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static uint64_t stat_percentile(const StatHist *h, double q) {
+    uint64_t count = __atomic_load_n(&h->count, __ATOMIC_RELAXED), seen = 0;
+    uint64_t want = (uint64_t)(q * (double)count + 0.5);
+    if (!want) want = 1;
+    for (unsigned b = 0; b < STAT_BUCKETS; ++b) {
+        seen += __atomic_load_n(&h->bucket[b], __ATOMIC_RELAXED);
+        if (seen >= want) {
+            uint64_t top = stat_bucket_top(b), max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+            return top < max ? top : max;
+        }
+    }
+    return 0;
+}
+
+#define STAT_START(t)       uint64_t t = stat_clock()
+#define STAT_STOP(op, t)    stat_record(op, stat_clock() - (t))
+#define STAT_COUNT(ct, n)   __atomic_fetch_add(&stat_counters[ct], (uint64_t)(n), __ATOMIC_RELAXED)
+
+static void stats_print(FILE *out) {
+    fprintf(out, "%-12s %10s %10s %10s %10s %10s %10s\n", "operation", "count", "mean us", "p50 us", "p90 us", "p99 us", "max us");
+    for (int op = 0; op < OP_COUNT; ++op) {
+        const StatHist *h = &stat_ops[op];
+        if (!h->count) continue;
+        fprintf(out, "%-12s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f\n", stat_op_names[op], (unsigned long)h->count,
+                h->sum_ns / 1e3 / (double)h->count, stat_percentile(h, 0.50) / 1e3,
+                stat_percentile(h, 0.90) / 1e3, stat_percentile(h, 0.99) / 1e3, h->max_ns / 1e3);
+    }
+    for (int c = 0; c < CT_COUNT; ++c)
+        fprintf(out, "%-14s %lu\n", stat_counter_names[c], (unsigned long)stat_counters[c]);
+}
+
+static int stats_write_json(const char *path) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!out) { perror(path); return 0; }
+    fprintf(out, "{\"ops\": {");
+    for (int op = 0; op < OP_COUNT; ++op) {
+        const StatHist *h = &stat_ops[op];
+        fprintf(out, "%s\n  \"%s\": {\"count\": %lu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f,"
+                " \"p99_us\": %.3f, \"max_us\": %.3f}", op ? "," : "", stat_op_names[op], (unsigned long)h->count,
+                h->count ? h->sum_ns / 1e3 / (double)h->count : 0.0, stat_percentile(h, 0.50) / 1e3,
+                stat_percentile(h, 0.90) / 1e3, stat_percentile(h, 0.99) / 1e3, h->max_ns / 1e3);
+    }
+    fprintf(out, "\n}, \"counters\": {");
+    for (int c = 0; c < CT_COUNT; ++c)
+        fprintf(out, "%s\n  \"%s\": %lu", c ? "," : "", stat_counter_names[c], (unsigned long)stat_counters[c]);
+    fprintf(out, "\n}}\n");
+    if (out == stdout) return fflush(out) == 0;
+    if (fclose(out) != 0) { perror(path); return 0; }
+    return 1;
+}
+#else
+#define STAT_START(t)       ((void)0)
+#define STAT_STOP(op, t)    ((void)0)
+#define STAT_COUNT(ct, n)   ((void)0)
+
+static void stats_print(FILE *out) {
+    fprintf(out, "Statistics were compiled out (NO_STATS).\n");
+}
+
+static int stats_write_json(const char *path) {
+    (void)stat_op_names;
+    (void)stat_counter_names;
+    fprintf(stderr, "%s: statistics were compiled out (NO_STATS)\n", path);
+    return 0;
+}
+#endif
+
+// the --stats-json dump, once a mode is done
+static void stats_dump(void) {
+    if (stats_json_path) stats_write_json(stats_json_path);
+}
+
+/* Trace spans: with --trace FILE every thread keeps the steps it timed in a
+   ring of its own, written at exit as Chrome trace-event JSON (load it in
+   chrome://tracing or Perfetto). With tracing off a span is one test of
+   trace_on where it opens; where it closes trace_span returns on the zero
+   stamp, so the call site has no branch of its own. */
+
+#define TRACE_RING 16384    // spans kept per thread; older ones are overwritten
+
+typedef struct {
+    const char *name;       // a string literal
+    uint64_t start, dur;    // ns
+} TraceEvent;
+
+typedef struct TraceRing {
+    struct TraceRing *next;
+    unsigned tid;
+    uint64_t n;             // spans recorded, the last TRACE_RING are kept
+    TraceEvent ev[TRACE_RING];
+} TraceRing;
+
+static int trace_on;
+static const char *trace_path;          // --trace FILE
+static uint64_t trace_t0;
+static TraceRing *trace_rings;
+static unsigned trace_threads;
+static __thread TraceRing *trace_mine;
+#ifndef _WIN32
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#define TRACE_BEGIN(t)      uint64_t t = trace_on ? stat_clock() : 0
+#define TRACE_END(t, name)  trace_span(name, t)
+
+static void trace_start(const char *path) {
+    trace_path = path;
+    trace_t0 = stat_clock();
+    trace_on = 1;
+}
+
+static void trace_span(const char *name, uint64_t start) {
+    if (!start) return;     // tracing off
+    uint64_t end = stat_clock();
+    TraceRing *r = trace_mine;
+    if (!r) {
+        r = calloc(1, sizeof *r);
+        if (!r) return;
+#ifndef _WIN32
+        pthread_mutex_lock(&trace_lock);
+#endif
+        r->tid = ++trace_threads;
+        r->next = trace_rings;
+        trace_rings = r;
+#ifndef _WIN32
+        pthread_mutex_unlock(&trace_lock);
+#endif
+        trace_mine = r;
+    }
+    TraceEvent *e = &r->ev[r->n++ % TRACE_RING];
+    e->name = name;
+    e->start = start;
+    e->dur = end - start;
+}
+
+// every ring as complete ("X") events; the other threads have been joined
+static int trace_write(const char *path) {
+    FILE *out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!out) { perror(path); return 0; }
+    fprintf(out, "{\"traceEvents\": [");
+    const char *sep = "";
+    for (const TraceRing *r = trace_rings; r; r = r->next) {
+        for (uint64_t i = r->n > TRACE_RING ? r->n - TRACE_RING : 0; i < r->n; ++i) {
+            const TraceEvent *e = &r->ev[i % TRACE_RING];
+            fprintf(out, "%s\n{\"name\": \"%s\", \"cat\": \"orders\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u,"
+                    " \"ts\": %.3f, \"dur\": %.3f}", sep, e->name, r->tid,
+                    (double)(e->start - trace_t0) / 1e3, (double)e->dur / 1e3);
+            sep = ",";
+        }
+        if (r->n > TRACE_RING)
+            fprintf(stderr, "trace: thread %u dropped its first %lu spans\n", r->tid, (unsigned long)(r->n - TRACE_RING));
+    }
+    fprintf(out, "\n], \"displayTimeUnit\": \"ns\"}\n");
+    if (out == stdout) return fflush(out) == 0;
+    if (fclose(out) != 0) { perror(path); return 0; }
+    return 1;
+}
+
+static void trace_dump(void) {
+    if (trace_on) trace_write(trace_path);
+}
+
+/* CSV file helpers  */
+
+static void ensure_csv_header(void) {
+    if (!store_lock(LK_EXCL)) return;
+    FILE *f = fopen(CSV_FILE, "r");
+    if (!f) {
+        FILE *w = fopen(CSV_FILE, "w");
+        if (w) {
+            fputs("orderid,customername,productname,quantity,price,orderdate\n", w);
+            fclose(w);
+        }
+        store_unlock();
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    if (size == 0) {
+        FILE *w = fopen(CSV_FILE, "w");
+        if (w) {
+            fputs("orderid,customername,productname,quantity,price,orderdate\n", w);
+            fclose(w);
+        }
+    }
+    store_unlock();
+}
+
+/* OrderID hash index (open addressing, duplicates allowed) */
+
+#define ID_EMPTY ((size_t)-1)
+#define ID_TOMB  ((size_t)-2)
+
+typedef struct {
+    int key;
+    size_t pos;     // row position, or ID_EMPTY / ID_TOMB
+} IdSlot;
+
+typedef struct {
+    IdSlot *slots;
+    size_t cap, used, tombs;    // cap is a power of two
+} IdIndex;
+
+static size_t id_hash(int key, size_t cap) {
+    return (size_t)(((uint32_t)key * 2654435761u) ^ ((uint32_t)key >> 16)) & (cap - 1);
+}
+
+static void idx_free(IdIndex *ix) {
+    free(ix->slots);
+    memset(ix, 0, sizeof *ix);
+}
+
+static int idx_insert(IdIndex *ix, int key, size_t pos);
+
+static int idx_grow(IdIndex *ix) {
+    size_t ncap = 64;
+    while (ncap * 7 < (ix->used + 1) * 20) ncap *= 2;   // ~35% full after grow
+
+    IdSlot *old = ix->slots;
+    size_t ocap = ix->cap;
+    IdSlot *p = malloc(ncap * sizeof *p);
+    if (!p) { perror("index"); return 0; }
+    for (size_t i = 0; i < ncap; ++i) p[i].pos = ID_EMPTY;
+
+    ix->slots = p;
+    ix->cap = ncap;
+    ix->used = ix->tombs = 0;
+    for (size_t i = 0; i < ocap; ++i)
+        if (old[i].pos != ID_EMPTY && old[i].pos != ID_TOMB) idx_insert(ix, old[i].key, old[i].pos);
+    free(old);
+    return 1;
+}
+
+static int idx_insert(IdIndex *ix, int key, size_t pos) {
+    if ((ix->used + ix->tombs + 1) * 10 > ix->cap * 7 && !idx_grow(ix)) return 0;
+    size_t i = id_hash(key, ix->cap);
+    while (ix->slots[i].pos != ID_EMPTY && ix->slots[i].pos != ID_TOMB) i = (i + 1) & (ix->cap - 1);
+    if (ix->slots[i].pos == ID_TOMB) ix->tombs--;
+    ix->slots[i].key = key;
+    ix->slots[i].pos = pos;
+    ix->used++;
+    return 1;
+}
+
+static void idx_remove(IdIndex *ix, int key, size_t pos) {
+    if (!ix->cap) return;
+    for (size_t i = id_hash(key, ix->cap); ix->slots[i].pos != ID_EMPTY; i = (i + 1) & (ix->cap - 1)) {
+        if (ix->slots[i].pos == pos && ix->slots[i].key == key) {
+            ix->slots[i].pos = ID_TOMB;
+            ix->used--;
+            ix->tombs++;
+            return;
+        }
+    }
+}
+
+// lowest row position for key, or ID_EMPTY
+static size_t idx_first(const IdIndex *ix, int key) {
+    size_t best = ID_EMPTY;
+    if (!ix->cap) return best;
+    for (size_t i = id_hash(key, ix->cap); ix->slots[i].pos != ID_EMPTY; i = (i + 1) & (ix->cap - 1))
+        if (ix->slots[i].pos != ID_TOMB && ix->slots[i].key == key && ix->slots[i].pos < best)
+            best = ix->slots[i].pos;
+    return best;
+}
+
+// all row positions for key in file order; caller frees *out
+static size_t idx_matches(const IdIndex *ix, int key, size_t **out) {
+    size_t n = 0, cap = 0;
+    *out = NULL;
+    if (!ix->cap) return 0;
+    for (size_t i = id_hash(key, ix->cap); ix->slots[i].pos != ID_EMPTY; i = (i + 1) & (ix->cap - 1)) {
+        if (ix->slots[i].pos == ID_TOMB || ix->slots[i].key != key) continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 4;
+            size_t *p = realloc(*out, cap * sizeof *p);
+            if (!p) { perror("index"); break; }
+            *out = p;
+        }
+        // insertion sort; duplicate runs are short
+        size_t j = n++;
+        while (j && (*out)[j-1] > ix->slots[i].pos) { (*out)[j] = (*out)[j-1]; j--; }
+        (*out)[j] = ix->slots[i].pos;
+    }
+    return n;
+}
+
+/* CSV line reader: walks a mapped file in place, stdio for anything else */
+
+typedef struct {
+    const char *base;       // mapping, NULL on the stdio path
+    size_t size, off, end;  // end = stop offset (snapshot bound)
+    FILE *f;
+    char *buf;              // stdio path: current line
+    size_t cap;
+} LineReader;
+
+static int reader_open_stream(LineReader *r, const char *path, size_t end) {
+    memset(r, 0, sizeof *r);
+    r->end = end;
+    r->f = fopen(path, "rb");
+    return r->f != NULL;
+}
+
+static int reader_open(LineReader *r, const char *path, size_t end) {
+    TRACE_BEGIN(tr);
+#ifndef _WIN32
+    memset(r, 0, sizeof *r);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            close(fd);
+            posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            r->base = p;
+            r->size = (size_t)st.st_size;
+            r->end = end < r->size ? end : r->size;
+            TRACE_END(tr, "open");
+            return 1;
+        }
+    }
+    close(fd);
+#endif
+    int ok = reader_open_stream(r, path, end);
+    TRACE_END(tr, "open");
+    return ok;
+}
+
+// next line including its newline; *offset is where it starts in the file
+static int reader_next(LineReader *r, const char **line, size_t *len, size_t *offset) {
+    if (r->base) {
+        if (r->off >= r->end) return 0;
+        const char *p = r->base + r->off;
+        const char *nl = memchr(p, '\n', r->end - r->off);
+        size_t n = nl ? (size_t)(nl - p) + 1 : r->end - r->off;
+        *line = p;
+        *len = n;
+        *offset = r->off;
+        r->off += n;
+        return 1;
+    }
+    if (!r->f || r->off >= r->end) return 0;
+    size_t n = 0;
+    for (;;) {
+        if (r->cap - n < 256) {
+            size_t ncap = r->cap ? r->cap * 2 : 1024;
+            char *b = realloc(r->buf, ncap);
+            if (!b) return 0;
+            r->buf = b;
+            r->cap = ncap;
+        }
+        if (!fgets(r->buf + n, (int)(r->cap - n), r->f)) break;
+        n += strlen(r->buf + n);
+        if (r->buf[n-1] == '\n') break;
+    }
+    if (n == 0) return 0;
+    *line = r->buf;
+    *len = n;
+    *offset = r->off;
+    r->off += n;
+    return 1;
+}
+
+static void reader_close(LineReader *r) {
+#ifndef _WIN32
+    if (r->base) munmap((void *)r->base, r->size);
+#endif
+    if (r->f) fclose(r->f);
+    free(r->buf);
+    memset(r, 0, sizeof *r);
+}
+
+// NUL-terminated copy for the string helpers; 0 if the line does not fit
+static int line_to_buf(const char *line, size_t len, char *buf, size_t cap) {
+    if (len >= cap) return 0;
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+    return 1;
+}
+
+/* Parallel scan: a worker pool runs the parts of a job, callers merge per-part results in part order */
+
+#define SCAN_MAX_THREADS 32
+
+static size_t scan_part_bytes = 1 << 20;    // smallest slice worth a worker
+static size_t scan_threads;                 // main thread included; 0 = online CPUs
+
+typedef void (*ScanFn)(void *job, size_t part);
+
+static size_t scan_width(void) {
+    if (!scan_threads) {
+        long n = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        scan_threads = n < 1 ? 1 : (size_t)n;
+    }
+    return scan_threads > SCAN_MAX_THREADS ? SCAN_MAX_THREADS : scan_threads;
+}
+
+// parts for a scan over `bytes`: a few per thread so uneven slices even out
+static size_t scan_parts(size_t bytes) {
+    size_t n = bytes / (scan_part_bytes ? scan_part_bytes : 1);
+    size_t most = scan_width() > 1 ? scan_width() * 4 : 1;
+    return n < 1 ? 1 : n > most ? most : n;
+}
+
+// cut[0..nparts] splits [lo, hi) right after `sep`, so no record straddles two parts
+static void scan_cut(const char *base, size_t lo, size_t hi, size_t nparts, char sep, size_t *cut) {
+    cut[0] = lo;
+    for (size_t i = 1; i < nparts; ++i) {
+        size_t at = lo + (hi - lo) / nparts * i;
+        if (at < cut[i-1]) at = cut[i-1];
+        const char *p = at < hi ? memchr(base + at, sep, hi - at) : NULL;
+        cut[i] = p ? (size_t)(p - base) + 1 : hi;
+    }
+    cut[nparts] = hi;
+}
+
+#ifndef _WIN32
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    int started;
+    ScanFn fn;
+    void *job;
+    size_t nparts, next, finished;
+    unsigned long gen;      // bumped per job so idle workers know to look
+} scan_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                0, NULL, NULL, 0, 0, 0, 0 };
+
+// run parts until none are left; lock held on entry and exit
+static void scan_drain(void) {
+    while (scan_pool.next < scan_pool.nparts) {
+        size_t part = scan_pool.next++;
+        ScanFn fn = scan_pool.fn;
+        void *job = scan_pool.job;
+        pthread_mutex_unlock(&scan_pool.lock);
+        fn(job, part);
+        pthread_mutex_lock(&scan_pool.lock);
+        if (++scan_pool.finished == scan_pool.nparts) pthread_cond_signal(&scan_pool.done);
+    }
+}
+
+static void *scan_worker(void *arg) {
+    unsigned long seen = 0;
+    (void)arg;
+    pthread_mutex_lock(&scan_pool.lock);
+    for (;;) {
+        while (scan_pool.gen == seen) pthread_cond_wait(&scan_pool.wake, &scan_pool.lock);
+        seen = scan_pool.gen;
+        scan_drain();
+    }
+    return NULL;
+}
+
+// workers are started once and then idle on the condition variable
+static int scan_start(void) {
+    if (scan_pool.started) return scan_pool.started > 0;
+    int n = 0;
+    for (size_t i = 1; i < scan_width(); ++i) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, scan_worker, NULL) != 0) break;
+        pthread_detach(t);
+        n++;
+    }
+    scan_pool.started = n ? 1 : -1;
+    return n > 0;
+}
+#endif
+
+// run fn over parts 0..nparts-1 and return when all are done; main thread only
+static void scan_run(ScanFn fn, void *job, size_t nparts) {
+#ifndef _WIN32
+    if (nparts > 1 && scan_start()) {
+        pthread_mutex_lock(&scan_pool.lock);
+        scan_pool.fn = fn;
+        scan_pool.job = job;
+        scan_pool.nparts = nparts;
+        scan_pool.next = scan_pool.finished = 0;
+        scan_pool.gen++;
+        pthread_cond_broadcast(&scan_pool.wake);
+        scan_drain();
+        while (scan_pool.finished < scan_pool.nparts) pthread_cond_wait(&scan_pool.done, &scan_pool.lock);
+        pthread_mutex_unlock(&scan_pool.lock);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < nparts; ++i) fn(job, i);
+}
+
+/* In-memory order store (loaded once, written back on change) */
+
+typedef struct {
+    int orderid, qty;
+    float price;
+    uint32_t date;  // packed yyyymmdd, 0 if the file's date is no calendar date
+    char customer[50], product[50];
+    char *raw;      // unparsable line kept verbatim; for an order with date 0, its date as the file had it
+} Order;
+
+// an unparsable line rather than an order (those never have date 0)
+static int row_is_line(const Order *o) {
+    return o->raw && o->date;
+}
+
+typedef struct {
+    size_t *pos;    // live order positions sorted by (date, position)
+    size_t len, cap;
+    int built;      // built on the first date query, then kept in step
+} DateIndex;
+
+typedef struct {
+    uint32_t gram;  // three lower-cased bytes; 0 marks an empty slot
+    uint32_t len, cap;
+    uint32_t *pos;  // ascending row positions
+} GramList;
+
+typedef struct {
+    GramList *slots;
+    size_t cap, used;   // cap is a power of two
+    int built;          // built on the first product query, then kept in step
+} GramIndex;
+
+typedef struct {
+    size_t start;   // offset of the name in buf
+    size_t row;
+} FoldRec;
+
+typedef struct {
+    char *buf;          // lower-cased product names, NUL-terminated, in write order
+    size_t len, cap;
+    FoldRec *recs;      // one per name in buf, ascending start
+    size_t nrecs, rcap;
+    size_t *at;         // row -> index into recs, FOLD_NONE if not an order
+    size_t atcap;
+} FoldColumn;
+
+typedef struct {
+    Order *rows;
+    size_t len, cap;
+    char *header;   // header line as read (with newline), NULL if none
+    IdIndex ids;    // OrderID -> row positions
+    DateIndex dates;
+    GramIndex grams;    // product trigram -> row positions
+    FoldColumn fold;    // product names, folded, for brute-force scans
+    uint64_t *dead;     // tombstones, one bit per row position, cap bits
+    size_t ndeleted;
+    long wal_bytes;     // end of the last good log record
+    int wal_torn;       // bytes past it not cut off yet (needs the exclusive lock)
+    int64_t csv_size, csv_mtime;    // the files as this process last saw them;
+    uint64_t csv_ino, gen;          // anything else means another process wrote
+    unsigned long loads;            // full reads so far
+    int loaded;
+    int tracking;       // the daemon keeps a read view; note what changes under it
+    int retouch;        // rows were renumbered: the next view starts over
+    size_t *touched;    // row positions written since the last publish
+    size_t ntouched, tcap;
+} OrderStore;
+
+static OrderStore store;
+static int store_writing;    // write sections open; inner ones ride on the outer
+
+// A deleted row keeps its position, so the indexes and the log records that
+// name positions stay valid until a checkpoint or compaction drops it.
+static int store_dead(size_t pos) {
+    return (int)(store.dead[pos / 64] >> (pos % 64) & 1);
+}
+
+static void store_mark(size_t pos, int dead) {
+    uint64_t bit = (uint64_t)1 << (pos % 64);
+    if (dead) store.dead[pos / 64] |= bit;
+    else store.dead[pos / 64] &= ~bit;
+}
+
+#define VIEW_CHUNK 256     // rows per copy-on-write chunk of a read view
+
+static int grow_array(void **p, size_t *cap, size_t need, size_t size);
+
+// row pos changes in the next view
+static void store_touch(size_t pos) {
+    if (!store.tracking) return;
+    if (store.ntouched && store.touched[store.ntouched - 1] == pos) return;
+    if (!grow_array((void **)&store.touched, &store.tcap, store.ntouched + 1, sizeof *store.touched)) {
+        store.retouch = 1;
+        return;
+    }
+    store.touched[store.ntouched++] = pos;
+}
+
+static char *dup_mem(const char *s, size_t n) {
+    char *p = malloc(n + 1);
+    if (p) { memcpy(p, s, n); p[n] = '\0'; }
+    return p;
+}
+
+static char *dup_str(const char *s) {
+    return dup_mem(s, strlen(s));
+}
+
+/* Date index: sorted positions, so a range query is a binary search plus a walk */
+
+static int date_before(size_t a, size_t b) {
+    uint32_t da = store.rows[a].date, db = store.rows[b].date;
+    return da < db || (da == db && a < b);
+}
+
+static int cmp_date_pos(const void *x, const void *y) {
+    size_t a = *(const size_t *)x, b = *(const size_t *)y;
+    return date_before(a, b) ? -1 : date_before(b, a);
+}
+
+// first slot whose row is not before row pos
+static size_t dates_lower(size_t pos) {
+    size_t lo = 0, hi = store.dates.len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (date_before(store.dates.pos[mid], pos)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void dates_reset(void) {
+    free(store.dates.pos);
+    memset(&store.dates, 0, sizeof store.dates);
+}
+
+static int dates_build(void) {
+    DateIndex *dx = &store.dates;
+    dates_reset();
+    dx->pos = malloc((store.len ? store.len : 1) * sizeof *dx->pos);
+    if (!dx->pos) { perror("date index"); return 0; }
+    dx->cap = store.len;
+    for (size_t i = 0; i < store.len; ++i)
+        if (!store.rows[i].raw && !store_dead(i)) dx->pos[dx->len++] = i;
+    qsort(dx->pos, dx->len, sizeof *dx->pos, cmp_date_pos);
+    dx->built = 1;
+    return 1;
+}
+
+static void dates_insert(size_t pos) {
+    DateIndex *dx = &store.dates;
+    if (!dx->built || !store.rows[pos].date) return;
+    if (dx->len == dx->cap) {
+        size_t ncap = dx->cap ? dx->cap * 2 : 256;
+        size_t *p = realloc(dx->pos, ncap * sizeof *p);
+        if (!p) { dates_reset(); return; }  // rebuilt on next query
+        dx->pos = p;
+        dx->cap = ncap;
+    }
+    size_t at = dates_lower(pos);
+    memmove(&dx->pos[at + 1], &dx->pos[at], (dx->len - at) * sizeof *dx->pos);
+    dx->pos[at] = pos;
+    dx->len++;
+}
+
+static void dates_erase(size_t pos) {
+    DateIndex *dx = &store.dates;
+    if (!dx->built) return;
+    size_t at = dates_lower(pos);
+    if (at < dx->len && dx->pos[at] == pos) {
+        memmove(&dx->pos[at], &dx->pos[at + 1], (dx->len - at - 1) * sizeof *dx->pos);
+        dx->len--;
+    }
+}
+
+// slots [*first, *first + count) hold the orders dated from..to inclusive;
+// rows deleted since the index was built are still there, tombstoned
+static size_t dates_range(uint32_t from, uint32_t to, size_t *first) {
+    DateIndex *dx = &store.dates;
+    size_t lo = 0, hi = dx->len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (store.rows[dx->pos[mid]].date < from) lo = mid + 1; else hi = mid;
+    }
+    *first = lo;
+    size_t end = lo;
+    while (end < dx->len && store.rows[dx->pos[end]].date <= to) end++;
+    return end - lo;
+}
+
+/* Product trigram index: a substring query intersects the lists of its grams */
+
+#define GRAM_MAX 48     // distinct grams in a product name (at most 49 bytes)
+
+static void product_fold(const char *src, char *dst, size_t cap) {
+    size_t n = 0;
+    for (; src[n] && n + 1 < cap; ++n) dst[n] = (char)tolower((unsigned char)src[n]);
+    dst[n] = '\0';
+}
+
+// distinct grams of a lower-cased string
+static size_t grams_of(const char *lc, uint32_t *out) {
+    size_t n = 0;
+    for (size_t i = 0; lc[i] && lc[i+1] && lc[i+2] && n < GRAM_MAX; ++i) {
+        uint32_t g = (uint32_t)(unsigned char)lc[i] << 16 |
+                     (uint32_t)(unsigned char)lc[i+1] << 8 | (unsigned char)lc[i+2];
+        size_t k = 0;
+        while (k < n && out[k] != g) k++;
+        if (k == n) out[n++] = g;
+    }
+    return n;
+}
+
+static GramList *gram_find(const GramIndex *gx, uint32_t g) {
+    if (!gx->cap) return NULL;
+    for (size_t i = id_hash((int)g, gx->cap); gx->slots[i].gram; i = (i + 1) & (gx->cap - 1))
+        if (gx->slots[i].gram == g) return &gx->slots[i];
+    return NULL;
+}
+
+static int gram_grow(GramIndex *gx) {
+    size_t ncap = gx->cap ? gx->cap * 2 : 1024;
+    GramList *p = calloc(ncap, sizeof *p);
+    if (!p) { perror("gram index"); return 0; }
+    for (size_t i = 0; i < gx->cap; ++i) {
+        if (!gx->slots[i].gram) continue;
+        size_t j = id_hash((int)gx->slots[i].gram, ncap);
+        while (p[j].gram) j = (j + 1) & (ncap - 1);
+        p[j] = gx->slots[i];
+    }
+    free(gx->slots);
+    gx->slots = p;
+    gx->cap = ncap;
+    return 1;
+}
+
+static GramList *gram_get(GramIndex *gx, uint32_t g) {
+    GramList *l = gram_find(gx, g);
+    if (l) return l;
+    if ((gx->used + 1) * 10 > gx->cap * 7 && !gram_grow(gx)) return NULL;
+    size_t i = id_hash((int)g, gx->cap);
+    while (gx->slots[i].gram) i = (i + 1) & (gx->cap - 1);
+    gx->slots[i].gram = g;
+    gx->used++;
+    return &gx->slots[i];
+}
+
+// first slot in l[from..len) holding a position >= pos
+static uint32_t gram_lower(const GramList *l, uint32_t from, uint32_t pos) {
+    uint32_t lo = from, hi = l->len;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (l->pos[mid] < pos) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// gram_lower for ascending probes: gallop from the last hit, then bisect
+static uint32_t gram_seek(const GramList *l, uint32_t from, uint32_t pos) {
+    uint32_t step = 1;
+    while (from + step < l->len && l->pos[from + step] < pos) step *= 2;
+    uint32_t lo = from + step / 2, hi = from + step < l->len ? from + step + 1 : l->len;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (l->pos[mid] < pos) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void gram_index_free(GramIndex *gx) {
+    for (size_t i = 0; i < gx->cap; ++i) free(gx->slots[i].pos);
+    free(gx->slots);
+    memset(gx, 0, sizeof *gx);
+}
+
+static void grams_reset(void) {
+    gram_index_free(&store.grams);
+}
+
+// list position pos under every gram of the folded name lc
+static int gram_index_add(GramIndex *gx, const char *lc, size_t pos) {
+    uint32_t g[GRAM_MAX];
+    size_t n = grams_of(lc, g);
+    for (size_t k = 0; k < n; ++k) {
+        GramList *l = gram_get(gx, g[k]);
+        if (!l) return 0;
+        if (l->len == l->cap) {
+            uint32_t ncap = l->cap ? l->cap * 2 : 4;
+            uint32_t *p = realloc(l->pos, ncap * sizeof *p);
+            if (!p) { perror("gram index"); return 0; }
+            l->pos = p;
+            l->cap = ncap;
+        }
+        // appends arrive in position order; updates land in the middle
+        uint32_t at = l->len && l->pos[l->len-1] > pos ? gram_lower(l, 0, (uint32_t)pos) : l->len;
+        memmove(&l->pos[at + 1], &l->pos[at], (l->len - at) * sizeof *l->pos);
+        l->pos[at] = (uint32_t)pos;
+        l->len++;
+    }
+    return 1;
+}
+
+static int grams_add(size_t pos) {
+    char lc[50];
+    product_fold(store.rows[pos].product, lc, sizeof lc);
+    return gram_index_add(&store.grams, lc, pos);
+}
+
+static void grams_drop(size_t pos) {
+    GramIndex *gx = &store.grams;
+    char lc[50];
+    uint32_t g[GRAM_MAX];
+    product_fold(store.rows[pos].product, lc, sizeof lc);
+    size_t n = grams_of(lc, g);
+    for (size_t k = 0; k < n; ++k) {
+        GramList *l = gram_find(gx, g[k]);
+        if (!l) continue;
+        uint32_t at = gram_lower(l, 0, (uint32_t)pos);
+        if (at < l->len && l->pos[at] == pos) {
+            memmove(&l->pos[at], &l->pos[at + 1], (l->len - at - 1) * sizeof *l->pos);
+            l->len--;
+        }
+    }
+}
+
+static int grams_build(void) {
+    grams_reset();
+    if (store.len > UINT32_MAX) return 0;
+    for (size_t i = 0; i < store.len; ++i)
+        if (!row_is_line(&store.rows[i]) && !store_dead(i) && !grams_add(i)) { grams_reset(); return 0; }
+    store.grams.built = 1;
+    return 1;
+}
+
+// ascending positions listed under every gram of needle_lc; caller frees *out.
+// Returns (size_t)-1 when the index cannot answer (needle under 3 bytes, no memory).
+static size_t gram_intersect(const GramIndex *gx, const char *needle_lc, uint32_t **out) {
+    uint32_t g[GRAM_MAX];
+    const GramList *lists[GRAM_MAX];
+    size_t n = grams_of(needle_lc, g);
+    *out = NULL;
+    if (!n || !gx->built) return (size_t)-1;
+
+    for (size_t k = 0; k < n; ++k) {
+        const GramList *l = gram_find(gx, g[k]);
+        if (!l || !l->len) return 0;
+        // shortest list first so it bounds the work
+        size_t j = k;
+        while (j && lists[j-1]->len > l->len) { lists[j] = lists[j-1]; j--; }
+        lists[j] = l;
+    }
+
+    uint32_t *c = malloc(lists[0]->len * sizeof *c);
+    if (!c) { perror("gram index"); return (size_t)-1; }
+    memcpy(c, lists[0]->pos, lists[0]->len * sizeof *c);
+    size_t m = lists[0]->len;
+    for (size_t k = 1; k < n && m; ++k) {
+        uint32_t from = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < m; ++i) {
+            from = gram_seek(lists[k], from, c[i]);
+            if (from == lists[k]->len) break;
+            if (lists[k]->pos[from] == c[i]) c[kept++] = c[i];
+        }
+        m = kept;
+    }
+    *out = c;
+    return m;
+}
+
+// ascending live positions whose product holds every gram of needle_lc, as above.
+// Lists keep deleted rows until the next rebuild; they are dropped here.
+static size_t grams_candidates(const char *needle_lc, uint32_t **out) {
+    size_t m = gram_intersect(&store.grams, needle_lc, out), kept = 0;
+    if (m == (size_t)-1) return m;
+    for (size_t i = 0; i < m; ++i)
+        if (!store_dead((*out)[i])) (*out)[kept++] = (*out)[i];
+    return kept;
+}
+
+/* Folded product column: one contiguous buffer scanned with a first/last byte filter */
+
+#define FOLD_NONE ((size_t)-1)
+
+typedef const char *(*FindFn)(const char *hay, size_t n, const char *nd, size_t m);
+
+static const char *find_scalar(const char *hay, size_t n, const char *nd, size_t m) {
+    const char *end = hay + n;
+    for (const char *p = hay; (size_t)(end - p) >= m; ++p) {
+        p = memchr(p, nd[0], (size_t)(end - p) - m + 1);
+        if (!p) return NULL;
+        if (p[m-1] == nd[m-1] && memcmp(p + 1, nd + 1, m > 2 ? m - 2 : 0) == 0) return p;
+    }
+    return NULL;
+}
+
+#ifdef FOLD_SIMD
+// compare a block of starts against the first byte and the block m-1 further on
+// against the last byte; only positions passing both get a memcmp
+#ifdef __SSE2__
+static const char *find_sse2(const char *hay, size_t n, const char *nd, size_t m) {
+    const __m128i first = _mm_set1_epi8(nd[0]), last = _mm_set1_epi8(nd[m-1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(hay + i + m - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first),
+                                                                  _mm_cmpeq_epi8(bl, last)));
+        while (mask) {
+            const char *p = hay + i + __builtin_ctz(mask);
+            if (memcmp(p + 1, nd + 1, m > 2 ? m - 2 : 0) == 0) return p;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(hay + i, n - i, nd, m);
+}
+#endif
+
+__attribute__((target("avx2")))
+static const char *find_avx2(const char *hay, size_t n, const char *nd, size_t m) {
+    const __m256i first = _mm256_set1_epi8(nd[0]), last = _mm256_set1_epi8(nd[m-1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(hay + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first),
+                                                                       _mm256_cmpeq_epi8(bl, last)));
+        while (mask) {
+            const char *p = hay + i + __builtin_ctz(mask);
+            if (memcmp(p + 1, nd + 1, m > 2 ? m - 2 : 0) == 0) return p;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(hay + i, n - i, nd, m);
+}
+#endif
+
+static FindFn find_pick(void) {
+#ifdef FOLD_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return find_avx2;
+#ifdef __SSE2__
+    return find_sse2;
+#endif
+#endif
+    return find_scalar;
+}
+
+static FindFn find_impl;
+
+static void fold_reset(void) {
+    FoldColumn *fc = &store.fold;
+    free(fc->buf);
+    free(fc->recs);
+    free(fc->at);
+    memset(fc, 0, sizeof *fc);
+}
+
+static int grow_array(void **p, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap) return 1;
+    size_t ncap = *cap ? *cap : 256;
+    while (ncap < need) ncap *= 2;
+    void *q = realloc(*p, ncap * size);
+    if (!q) { perror("realloc"); return 0; }
+    *p = q;
+    *cap = ncap;
+    return 1;
+}
+
+// blank the row's current copy; a run of NULs never matches a needle
+static void fold_drop(size_t pos) {
+    FoldColumn *fc = &store.fold;
+    if (pos >= fc->atcap || fc->at[pos] == FOLD_NONE) return;
+    char *name = fc->buf + fc->recs[fc->at[pos]].start;
+    memset(name, 0, strlen(name));
+    fc->at[pos] = FOLD_NONE;
+}
+
+// (re)write the row's folded name at the end of the buffer
+static int fold_put(size_t pos) {
+    FoldColumn *fc = &store.fold;
+    size_t old = fc->atcap;
+    if (!grow_array((void **)&fc->at, &fc->atcap, pos + 1, sizeof *fc->at)) return 0;
+    for (size_t i = old; i < fc->atcap; ++i) fc->at[i] = FOLD_NONE;
+    if (!grow_array((void **)&fc->buf, &fc->cap, fc->len + sizeof store.rows[pos].product, 1) ||
+        !grow_array((void **)&fc->recs, &fc->rcap, fc->nrecs + 1, sizeof *fc->recs)) return 0;
+
+    fold_drop(pos);
+    char *name = fc->buf + fc->len;
+    product_fold(store.rows[pos].product, name, sizeof store.rows[pos].product);
+    fc->recs[fc->nrecs].start = fc->len;
+    fc->recs[fc->nrecs].row = pos;
+    fc->at[pos] = fc->nrecs++;
+    fc->len += strlen(name) + 1;
+    return 1;
+}
+
+static int fold_build(void) {
+    fold_reset();
+    for (size_t i = 0; i < store.len; ++i)
+        if (!row_is_line(&store.rows[i]) && !store_dead(i) && !fold_put(i)) return 0;
+    return 1;
+}
+
+static const char *fold_name(size_t pos) {
+    const FoldColumn *fc = &store.fold;
+    return pos < fc->atcap && fc->at[pos] != FOLD_NONE ? fc->buf + fc->recs[fc->at[pos]].start : "";
+}
+
+static int cmp_size(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+// last record starting at or before offset `at`; gallops from `from` because
+// hits only move forward, then bisects
+static size_t fold_rec_at(size_t from, size_t at) {
+    const FoldColumn *fc = &store.fold;
+    size_t step = 1;
+    while (from + step < fc->nrecs && fc->recs[from + step].start <= at) step *= 2;
+    size_t lo = from + step / 2, hi = from + step < fc->nrecs ? from + step : fc->nrecs;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (fc->recs[mid].start <= at) lo = mid + 1; else hi = mid;
+    }
+    return lo - 1;
+}
+
+typedef struct {
+    const char *needle;
+    size_t m;
+    size_t *cut;        // part boundaries, on record starts
+    size_t **hits, *nhits;
+} FoldJob;
+
+static void fold_scan_part(void *arg, size_t part) {
+    FoldJob *j = arg;
+    const FoldColumn *fc = &store.fold;
+    size_t lo = j->cut[part], n = 0, cap = 0, *out = NULL;
+    size_t rec = lo < fc->len ? fold_rec_at(0, lo) : 0;
+
+    const char *p = fc->buf + lo, *end = fc->buf + j->cut[part + 1];
+    while ((p = find_impl(p, (size_t)(end - p), j->needle, j->m)) != NULL) {
+        rec = fold_rec_at(rec, (size_t)(p - fc->buf));
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            size_t *q = realloc(out, cap * sizeof *q);
+            if (!q) { perror("fold scan"); break; }
+            out = q;
+        }
+        out[n++] = fc->recs[rec].row;
+        p += strlen(p) + 1;     // one hit per name
+    }
+    j->hits[part] = out;
+    j->nhits[part] = n;
+}
+
+// rows whose folded product contains needle_lc, in file order; caller frees *out
+static size_t fold_scan(const char *needle_lc, size_t **out) {
+    const FoldColumn *fc = &store.fold;
+    size_t m = strlen(needle_lc), total;
+    *out = NULL;
+    if (!m || !fc->len) return 0;
+    if (!find_impl) find_impl = find_pick();
+
+    size_t nparts = scan_parts(fc->len);
+    size_t *cut = malloc((nparts + 1) * sizeof *cut);
+    size_t **hits = calloc(nparts, sizeof *hits);
+    size_t *nhits = calloc(nparts, sizeof *nhits);
+    if (!cut || !hits || !nhits) { perror("fold scan"); free(cut); free(hits); free(nhits); return 0; }
+    scan_cut(fc->buf, 0, fc->len, nparts, '\0', cut);
+
+    FoldJob job = { needle_lc, m, cut, hits, nhits };
+    scan_run(fold_scan_part, &job, nparts);
+
+    size_t *all = hits[0];
+    total = nhits[0];
+    if (nparts > 1) {
+        for (size_t i = 1; i < nparts; ++i) total += nhits[i];
+        all = malloc((total ? total : 1) * sizeof *all);
+        if (!all) { perror("fold scan"); total = 0; }
+        for (size_t i = 0, k = 0; i < nparts; k += nhits[i], ++i) {
+            if (all) memcpy(all + k, hits[i], nhits[i] * sizeof *all);
+            free(hits[i]);
+        }
+    }
+    free(cut);
+    free(hits);
+    free(nhits);
+
+    // rewritten names sit at the end of the buffer
+    for (size_t i = 1; i < total; ++i)
+        if (all[i-1] > all[i]) { qsort(all, total, sizeof *all, cmp_size); break; }
+    *out = all;
+    return total;
+}
+
+static void store_free(void) {
+    for (size_t i = 0; i < store.len; ++i) free(store.rows[i].raw);
+    free(store.rows);
+    free(store.header);
+    idx_free(&store.ids);
+    dates_reset();
+    grams_reset();
+    fold_reset();
+    free(store.dead);
+    free(store.touched);
+    memset(&store, 0, sizeof store);
+}
+
+static Order *store_append(const Order *o) {
+    if (store.len == store.cap) {
+        size_t ncap = store.cap ? store.cap * 2 : 256;
+        Order *p = realloc(store.rows, ncap * sizeof *p);
+        if (!p) { perror("store"); return NULL; }
+        store.rows = p;
+        uint64_t *d = realloc(store.dead, ncap / 64 * sizeof *d);
+        if (!d) { perror("store"); return NULL; }
+        memset(d + store.cap / 64, 0, (ncap - store.cap) / 64 * sizeof *d);
+        store.dead = d;
+        store.cap = ncap;
+    }
+    if (!row_is_line(o) && !idx_insert(&store.ids, o->orderid, store.len)) return NULL;
+    store.rows[store.len] = *o;
+    if (!row_is_line(o) && !fold_put(store.len)) { idx_remove(&store.ids, o->orderid, store.len); return NULL; }
+    if (!row_is_line(o)) {
+        dates_insert(store.len);
+        if (store.grams.built && !grams_add(store.len)) grams_reset();
+    }
+    store_touch(store.len);
+    return &store.rows[store.len++];
+}
+
+// replace a live order in place (same OrderID), keeping the secondary indexes in step.
+// An edit never brings a date text, only a real date: the row keeps its own text
+// until then (o->raw may be a stale copy of it from before a reload)
+static void store_set(size_t pos, const Order *o) {
+    Order *cur = &store.rows[pos];
+    char *text = cur->raw;
+    int redate = cur->date != o->date;
+    int reprod = strcmp(cur->product, o->product) != 0;
+    if (redate) dates_erase(pos);
+    if (reprod && store.grams.built) grams_drop(pos);
+    *cur = *o;
+    cur->raw = cur->date ? NULL : text;
+    if (cur->date) free(text);
+    if (redate) dates_insert(pos);
+    if (reprod) {
+        if (!fold_put(pos)) fold_drop(pos);     // unsearchable until the next load
+        if (store.grams.built && !grams_add(pos)) grams_reset();
+    }
+    store_touch(pos);
+}
+
+// Only the ID index, which must say exactly whether an ID exists, and the
+// fold column (blanking a name is O(1)) drop the row now. The date and
+// trigram lists keep it, tombstoned, until they are rebuilt after a swap:
+// erasing from them moved up to every later position on each delete.
+static void store_remove(size_t pos) {
+    if (store_dead(pos)) return;
+    Order *o = &store.rows[pos];
+    idx_remove(&store.ids, o->orderid, pos);
+    fold_drop(pos);
+    store_mark(pos, 1);
+    store.ndeleted++;
+    store_touch(pos);
+}
+
+// a row is an order if it tokenizes; a date that is no calendar date is
+// kept as text in raw (date 0), so the row still answers to its OrderID
+static int order_from_line(const char *line, size_t len, Order *o) {
+    CsvRow cr;
+    if (!csv_tokenize(line, len, &cr)) return 0;
+    o->orderid = cr.orderid;
+    o->qty = cr.qty;
+    o->price = cr.price;
+    o->date = date_pack(cr.date, cr.date_len);
+    o->raw = o->date ? NULL : dup_mem(cr.date, cr.date_len);
+    if (!o->date && !o->raw) return 0;
+    copy_field(o->customer, cr.customer, cr.customer_len);
+    copy_field(o->product, cr.product, cr.product_len);
+    return 1;
+}
+
+// any line of the file: an order, or kept verbatim (date never 0, see row_is_line)
+static void row_from_line(const char *line, size_t len, Order *o) {
+    memset(o, 0, sizeof *o);
+    if (order_from_line(line, len, o)) return;
+    o->raw = dup_mem(line, len); /* preserve unknown lines */
+    o->date = UINT32_MAX;
+}
+
+static void checkpoint_recover(void);
+static int path_exists(const char *path);
+static int wal_replay(long from);
+static void compact_wait(void);
+static void compact_poll(void);
+static int commit_flush(void);
+
+typedef struct {
+    const char *base;
+    size_t *cut;        // part boundaries, on line starts
+    Order **rows;
+    size_t *nrows;
+    char *short_part;   // set when a part ran out of memory midway
+} LoadJob;
+
+static void load_part(void *arg, size_t part) {
+    TRACE_BEGIN(tr);
+    LoadJob *j = arg;
+    LineReader r;
+    memset(&r, 0, sizeof r);
+    r.base = j->base;
+    r.off = j->cut[part];
+    r.end = j->cut[part + 1];
+
+    const char *line;
+    size_t len, off, n = 0, cap = 0;
+    Order *rows = NULL;
+    while (reader_next(&r, &line, &len, &off)) {
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            Order *p = realloc(rows, cap * sizeof *p);
+            if (!p) { perror("load"); j->short_part[part] = 1; break; }
+            rows = p;
+        }
+        Order *o = &rows[n++];
+        row_from_line(line, len, o);
+    }
+    j->rows[part] = rows;
+    j->nrows[part] = n;
+    TRACE_END(tr, "parse");
+}
+
+// parse the rest of a mapped file on the scan pool, then append in file order
+static void load_parallel(LineReader *r, size_t nparts) {
+    size_t *cut = malloc((nparts + 1) * sizeof *cut);
+    Order **rows = calloc(nparts, sizeof *rows);
+    size_t *nrows = calloc(nparts, sizeof *nrows);
+    char *short_part = calloc(nparts, 1);
+    if (!cut || !rows || !nrows || !short_part) {
+        perror("load"); free(cut); free(rows); free(nrows); free(short_part); return;
+    }
+    scan_cut(r->base, r->off, r->end, nparts, '\n', cut);
+
+    LoadJob job = { r->base, cut, rows, nrows, short_part };
+    scan_run(load_part, &job, nparts);
+
+    int ok = 1;
+    for (size_t i = 0; i < nparts; ++i) {
+        for (size_t k = 0; k < nrows[i]; ++k) {
+            if (ok && !store_append(&rows[i][k])) ok = 0;
+            if (!ok) free(rows[i][k].raw);
+        }
+        if (short_part[i]) ok = 0;      // stop where the sequential path would
+        free(rows[i]);
+    }
+    free(cut);
+    free(rows);
+    free(nrows);
+    free(short_part);
+}
+
+// remember what the files look like now; a lock is held
+static void store_mark_seen(void) {
+    struct stat st;
+    if (stat(CSV_FILE, &st) == 0) {
+        store.csv_size = st.st_size;
+        store.csv_mtime = st.st_mtime;
+        store.csv_ino = (uint64_t)st.st_ino;
+    } else {
+        store.csv_size = store.csv_mtime = 0;
+        store.csv_ino = 0;
+    }
+    if (!store.wal_torn) store.wal_bytes = stat(WAL_FILE, &st) == 0 ? (long)st.st_size : 0;
+    store.gen = lock_gen();
+}
+
+// read the whole CSV once, then replay the change log; a lock is held
+static int store_read(void) {
+    STAT_START(t0);
+    int tracking = store.tracking;
+    unsigned long loads = store.loads;
+    store_free();
+    store.tracking = tracking;      // the daemon's view starts over instead
+    store.retouch = tracking;
+    store.loads = loads + 1;
+    LineReader r;
+    if (!reader_open(&r, CSV_FILE, (size_t)-1)) { perror(CSV_FILE); return 0; }
+
+    const char *line;
+    size_t len, off;
+    int first = 1, split = r.base != NULL;
+    TRACE_BEGIN(tr);
+    while (reader_next(&r, &line, &len, &off)) {
+        if (first) {
+            char buf[512];
+            first = 0;
+            if (!line_to_buf(line, len, buf, sizeof buf) || !line_starts_with_digit(buf)) {
+                store.header = dup_mem(line, len);
+                continue;
+            }
+        }
+        // big mapped files: hand the data lines to the scan pool
+        size_t nparts = split ? scan_parts(r.end - off) : 1;
+        split = 0;
+        if (nparts > 1) {
+            r.off = off;
+            load_parallel(&r, nparts);
+            break;
+        }
+        Order o;
+        row_from_line(line, len, &o);
+        if (!store_append(&o)) { free(o.raw); break; }
+    }
+    reader_close(&r);
+    TRACE_END(tr, "scan");
+    wal_replay(0);
+    store_mark_seen();
+    store.loaded = 1;
+    STAT_COUNT(CT_BYTES_READ, store.csv_size + store.wal_bytes);
+    STAT_STOP(OP_LOAD, t0);
+    return 1;
+}
+
+// rows another process appended past `from`; a lock is held
+static int store_read_tail(int64_t from) {
+    LineReader r;
+    if (!reader_open(&r, CSV_FILE, (size_t)-1)) return 0;
+    if (r.base) r.off = (size_t)from;
+    else if (fseek(r.f, (long)from, SEEK_SET) == 0) r.off = (size_t)from;
+    else { reader_close(&r); return 0; }
+    const char *line;
+    size_t len, off;
+    int ok = 1;
+    while (ok && reader_next(&r, &line, &len, &off)) {
+        Order o;
+        row_from_line(line, len, &o);
+        if (!store_append(&o)) { free(o.raw); ok = 0; }
+    }
+    reader_close(&r);
+    return ok;
+}
+
+// catch up with other processes; a lock is held. Appends to the CSV or the
+// log are read from where we stopped; a swap (new generation or inode) or a
+// file that shrank or was rewritten in place means reading everything again.
+static int store_sync(void) {
+    struct stat cs, ws;
+    if (stat(CSV_FILE, &cs) != 0) return store_read();
+    long wal_size = stat(WAL_FILE, &ws) == 0 ? (long)ws.st_size : 0;
+    int64_t csv_size = cs.st_size, csv_mtime = cs.st_mtime;
+    int same_csv = csv_size == store.csv_size && csv_mtime == store.csv_mtime;
+    if (lock_gen() != store.gen || (uint64_t)cs.st_ino != store.csv_ino || store.csv_size == 0
+        || csv_size < store.csv_size || (csv_size == store.csv_size && !same_csv)
+        || wal_size < store.wal_bytes)
+        return store_read();
+    if (same_csv && wal_size == store.wal_bytes) return 1;
+    STAT_COUNT(CT_BYTES_READ, (csv_size - store.csv_size) + (wal_size - store.wal_bytes));
+    if (csv_size > store.csv_size && !store_read_tail(store.csv_size)) return store_read();
+    if (wal_size > store.wal_bytes) wal_replay(store.wal_bytes);
+    store_mark_seen();
+    return 1;
+}
+
+static int store_load(void) {
+    compact_wait();
+    // an interrupted swap is repaired with everyone else kept out
+    int repair = path_exists(WAL_FILE ".old") || path_exists(WAL_FILE ".next") || !path_exists(CSV_FILE);
+    if (!store_lock(repair ? LK_EXCL : LK_SHARED)) return 0;
+    if (repair) checkpoint_recover();
+    int ok = store_read();
+    // a torn log tail is cut off before anyone appends behind it
+    if (ok && store.wal_torn && store_lock(LK_EXCL)) ok = store_sync();
+    store_unlock();
+    return ok;
+}
+
+// shared lock only while catching up; lookups then work on memory alone
+static int store_refresh(void) {
+    if (store_writing) return 1;    // already current, and the lock must stay exclusive
+    if (!store_lock(LK_SHARED)) return 0;
+    int ok = store_sync();
+    store_unlock();
+    return ok;
+}
+
+static int store_ensure_loaded(void) {
+    if (!store.loaded) return store_load();
+    compact_poll();
+    return store_refresh();
+}
+
+// changes happen between these two: exclusive lock, table brought up to date
+static int store_write_begin(void) {
+    if (store_writing++) return 1;
+    if (store_lock(LK_EXCL)) {
+        if (store_sync()) return 1;
+        store_unlock();
+    }
+    store_writing = 0;
+    return 0;
+}
+
+// the section's appends go out here; 0 if they did not, and memory is
+// read back from the files so it does not claim rows that never landed
+static int store_write_end(void) {
+    if (--store_writing > 0) return 1;
+    int ok = commit_flush();
+    if (!ok) store_read();
+    store_mark_seen();
+    store_unlock();
+    return ok;
+}
+
+// an order's date as text: formatted, or as the file had it
+static const char *order_date(const Order *o, char *buf, size_t cap) {
+    if (!o->date) return o->raw;
+    date_format(o->date, buf, cap);
+    return buf;
+}
+
+// one CSV row with its newline; returns the length like snprintf
+static int format_order(char *buf, size_t cap, const Order *o) {
+    char date[16];
+    return snprintf(buf, cap, "%d,%s,%s,%d,%.2f,%s\n", o->orderid, o->customer, o->product,
+                    o->qty, o->price, order_date(o, date, sizeof date));
+}
+
+static void write_order(FILE *f, const Order *o) {
+    char line[256];
+    format_order(line, sizeof line, o);
+    fputs(line, f);
+}
+
+static void print_order(const char *prefix, const Order *o) {
+    char date[16];
+    printf("%s%d, %s, %s, %d, %.2f, %s\n", prefix, o->orderid, o->customer, o->product,
+           o->qty, o->price, order_date(o, date, sizeof date));
+}
+
+/* Commit layer: appends collect in memory and leave in one write per file
+   when the write section ends; durability decides when fdatasync follows */
+
+#define DURABLE_NONE  0     // the OS writes back when it likes (a power cut can lose recent edits)
+#define DURABLE_OP    1     // every write section waits for its fdatasync before replying
+#define DURABLE_GROUP 2     // a flusher thread syncs within the window; COMMIT_GROUP_OPS sections sync at once
+
+#define COMMIT_GROUP_OPS 64
+#define COMMIT_GROUP_MS  10
+
+#define COMMIT_CSV 1
+#define COMMIT_WAL 2
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+} CommitBuf;
+
+typedef struct {
+    CommitBuf csv, wal;             // pending appends of the open write section
+    int mode;
+    unsigned long group_ops, group_ms;
+    unsigned dirty;                 // COMMIT_* written but not synced yet
+    unsigned long unsynced;         // write sections since the last sync
+    unsigned long writes, syncs;    // write() calls and fdatasync rounds so far
+} CommitLog;
+
+static CommitLog commit = { { NULL, 0, 0 }, { NULL, 0, 0 }, DURABLE_NONE, COMMIT_GROUP_OPS, COMMIT_GROUP_MS, 0, 0, 0, 0 };
+#ifndef _WIN32
+static pthread_mutex_t commit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t commit_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t commit_thread;
+static int commit_started, commit_stop;
+#endif
+
+// "none", "op" or "group[,OPS[,MS]]"
+static int commit_parse_mode(const char *s) {
+    unsigned long ops = COMMIT_GROUP_OPS, ms = COMMIT_GROUP_MS;
+    if (strcmp(s, "none") == 0) commit.mode = DURABLE_NONE;
+    else if (strcmp(s, "op") == 0) commit.mode = DURABLE_OP;
+    else if (strncmp(s, "group", 5) == 0 && (!s[5] || (s[5] == ',' && sscanf(s + 6, "%lu,%lu", &ops, &ms) >= 1))) {
+        if (!ops || !ms) return 0;
+        commit.mode = DURABLE_GROUP;
+        commit.group_ops = ops;
+        commit.group_ms = ms;
+    } else return 0;
+    return 1;
+}
+
+static int commit_put(CommitBuf *b, const char *s, size_t n) {
+    if (!grow_array((void **)&b->buf, &b->cap, b->len + n, 1)) return 0;
+    memcpy(b->buf + b->len, s, n);
+    b->len += n;
+    return 1;
+}
+
+// append a pending buffer to its file in one write
+static int commit_write(const char *path, CommitBuf *b) {
+    if (!b->len) return 1;
+    TRACE_BEGIN(tr);
+    int ok = 1;
+#ifndef _WIN32
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) { perror(path); ok = 0; }
+    for (size_t done = 0; ok && done < b->len; ) {
+        ssize_t w = write(fd, b->buf + done, b->len - done);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) { perror(path); ok = 0; }
+        else done += (size_t)w;
+    }
+    if (fd >= 0 && close(fd) != 0 && ok) { perror(path); ok = 0; }
+#else
+    FILE *f = fopen(path, "ab");
+    if (!f) { perror(path); ok = 0; }
+    else {
+        if (fwrite(b->buf, 1, b->len, f) != b->len) ok = 0;
+        if (fclose(f) != 0 || !ok) { perror(path); ok = 0; }
+    }
+#endif
+    commit.writes++;
+    if (ok) STAT_COUNT(CT_BYTES_WRITTEN, b->len);
+    b->len = 0;
+    TRACE_END(tr, "append");
+    return ok;
+}
+
+// fdatasync whatever is now at path; also used for orders.tmp before a swap
+static int commit_sync_path(const char *path) {
+#ifndef _WIN32
+    int fd = open(path, O_WRONLY);
+    if (fd < 0 && errno == ENOENT) return 1;    // swapped meanwhile; the swap synced its file
+    if (fd < 0) { perror(path); return 0; }
+    TRACE_BEGIN(tr);
+#ifdef __linux__
+    int rc = fdatasync(fd);
+#else
+    int rc = fsync(fd);
+#endif
+    if (rc != 0) perror(path);
+    close(fd);
+    TRACE_END(tr, "fsync");
+    return rc == 0;
+#else
+    (void)path;
+    return 1;
+#endif
+}
+
+static int commit_sync_files(unsigned dirty) {
+    int ok = 1;
+    if (dirty & COMMIT_CSV) ok &= commit_sync_path(CSV_FILE);
+    if (dirty & COMMIT_WAL) ok &= commit_sync_path(WAL_FILE);
+    if (!dirty) return ok;
+#ifndef _WIN32
+    pthread_mutex_lock(&commit_lock);   // the flusher counts too
+    commit.syncs++;
+    pthread_mutex_unlock(&commit_lock);
+#else
+    commit.syncs++;
+#endif
+    return ok;
+}
+
+#ifndef _WIN32
+// group mode: sync at most group_ms after the first unsynced write section
+static void *commit_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&commit_lock);
+    while (!commit_stop) {
+        if (!commit.dirty) { pthread_cond_wait(&commit_wake, &commit_lock); continue; }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += (time_t)(commit.group_ms / 1000);
+        ts.tv_nsec += (long)(commit.group_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+        while (!commit_stop && pthread_cond_timedwait(&commit_wake, &commit_lock, &ts) == 0) {}
+        unsigned dirty = commit.dirty;
+        commit.dirty = 0;
+        commit.unsynced = 0;
+        pthread_mutex_unlock(&commit_lock);
+        commit_sync_files(dirty);
+        pthread_mutex_lock(&commit_lock);
+    }
+    pthread_mutex_unlock(&commit_lock);
+    return NULL;
+}
+#endif
+
+// end of a write section, data lock still held: write, then sync per mode
+static int commit_flush(void) {
+    unsigned written = (commit.csv.len ? COMMIT_CSV : 0) | (commit.wal.len ? COMMIT_WAL : 0);
+    int ok = commit_write(CSV_FILE, &commit.csv);
+    ok &= commit_write(WAL_FILE, &commit.wal);
+    if (!ok || !written || commit.mode == DURABLE_NONE) return ok;
+    if (commit.mode == DURABLE_OP) return commit_sync_files(written);
+
+    unsigned due = 0;
+#ifndef _WIN32
+    pthread_mutex_lock(&commit_lock);
+    if (!commit_started && pthread_create(&commit_thread, NULL, commit_main, NULL) == 0) commit_started = 1;
+    if (!commit.dirty) pthread_cond_signal(&commit_wake);
+#endif
+    commit.dirty |= written;
+    if (++commit.unsynced >= commit.group_ops || !commit_started) {
+        due = commit.dirty;
+        commit.dirty = 0;
+        commit.unsynced = 0;
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock(&commit_lock);
+#endif
+    return commit_sync_files(due);
+}
+
+// stop the flusher and sync what it still owes; before exit
+static void commit_close(void) {
+#ifndef _WIN32
+    pthread_mutex_lock(&commit_lock);
+    commit_stop = 1;
+    pthread_cond_signal(&commit_wake);
+    pthread_mutex_unlock(&commit_lock);
+    if (commit_started) pthread_join(commit_thread, NULL);
+    commit_started = commit_stop = 0;
+#endif
+    commit_sync_files(commit.dirty);
+    commit.dirty = 0;
+    commit.unsynced = 0;
+    free(commit.csv.buf);
+    free(commit.wal.buf);
+    memset(&commit.csv, 0, sizeof commit.csv);
+    memset(&commit.wal, 0, sizeof commit.wal);
+}
+
+/* Change log: edits are appended to WAL_FILE and folded in at checkpoints */
+
+// row positions count every data line of the CSV (header excluded), so they
+// stay valid while the CSV only grows by appends
+//   U,<pos>,<orderid>,<customer>,<product>,<qty>,<price>,<date>
+//   D,<pos>
+
+static int wal_append_update(size_t pos, const Order *o) {
+    char line[320];
+    int n = snprintf(line, sizeof line, "U,%lu,", (unsigned long)pos);
+    n += format_order(line + n, sizeof line - (size_t)n, o);
+    return commit_put(&commit.wal, line, (size_t)n);
+}
+
+static int wal_append_delete(size_t pos) {
+    char line[32];
+    int n = snprintf(line, sizeof line, "D,%lu\n", (unsigned long)pos);
+    return commit_put(&commit.wal, line, (size_t)n);
+}
+
+// apply one log record; 0 if it is torn or does not fit the table
+static int wal_apply(const char *line) {
+    unsigned long pos;
+    int n = 0;
+    if (line[0] == 'D') {
+        if (sscanf(line, "D,%lu%n", &pos, &n) != 1 || line[n] != '\n' || pos >= store.len) return 0;
+        store_remove((size_t)pos);
+        return 1;
+    }
+    if (line[0] == 'U') {
+        Order o;
+        memset(&o, 0, sizeof o);
+        if (sscanf(line, "U,%lu,%n", &pos, &n) != 1 || n == 0 || pos >= store.len) return 0;
+        if (!strchr(line, '\n')) return 0; // torn tail
+        if (!order_from_line(line + n, strlen(line + n), &o)) return 0;
+        Order *cur = &store.rows[pos];
+        int ok = !row_is_line(cur) && !store_dead(pos) && cur->orderid == o.orderid && (o.date || !cur->date);
+        if (ok) store_set((size_t)pos, &o);
+        free(o.raw);
+        return ok;
+    }
+    return 0;
+}
+
+// apply the log from byte `from` on (0 at load, else where we stopped reading).
+// Whatever follows the first damaged record (a crash or a short write left it
+// torn) is cut off under the exclusive lock; a record appended behind it would
+// share its line and be lost on every later replay.
+static int wal_replay(long from) {
+    FILE *f = fopen(WAL_FILE, "r");
+    if (!f) return 0;
+    if (from && fseek(f, from, SEEK_SET) != 0) { fclose(f); return 0; }
+    TRACE_BEGIN(tr);
+    char line[512];
+    int applied = 0;
+    long good = from;
+    while (fgets(line, sizeof line, f)) {
+        if (!wal_apply(line)) break;  // stop at the first damaged record
+        applied++;
+        good = ftell(f);
+    }
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    fclose(f);
+    store.wal_bytes = good;
+    store.wal_torn = good < end;
+#ifndef _WIN32
+    if (store.wal_torn && store_locked == LK_EXCL) {
+        if (truncate(WAL_FILE, good) == 0) store.wal_torn = 0;
+        else perror(WAL_FILE);
+    }
+#endif
+    TRACE_END(tr, "log replay");
+    return applied;
+}
+
+static int path_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// finish or roll back a checkpoint/compaction swap that was interrupted
+static void checkpoint_recover(void) {
+    int has_tmp = path_exists("orders.tmp"), has_csv = path_exists(CSV_FILE);
+
+    if (!path_exists(WAL_FILE ".old")) {
+        // died before parking the log: the old CSV + log are still current
+        if (!has_csv && has_tmp && rename("orders.tmp", CSV_FILE) != 0) perror("rename tmp->csv");
+        remove(WAL_FILE ".next");
+        return;
+    }
+
+    if (has_tmp && has_csv) {   // CSV untouched: keep replaying the old log
+        remove("orders.tmp");
+        remove(WAL_FILE ".next");
+        if (rename(WAL_FILE ".old", WAL_FILE) != 0) perror("restore log");
+        return;
+    }
+    if (has_tmp && rename("orders.tmp", CSV_FILE) != 0) { perror("rename tmp->csv"); return; }
+    // CSV already holds everything the old log had; a compaction leaves the
+    // records written after its snapshot in .next
+    if (path_exists(WAL_FILE ".next") && rename(WAL_FILE ".next", WAL_FILE) != 0) { perror("install log"); return; }
+    remove(WAL_FILE ".old");
+}
+
+// CSV from memory via orders.tmp + rename, then drop the log; locks are held
+static int checkpoint_write(void) {
+    TRACE_BEGIN(tw);
+    FILE *out = fopen("orders.tmp", "w");
+    if (!out) { perror("orders.tmp"); return 0; }
+
+    if (store.header) fputs(store.header, out);
+    for (size_t i = 0; i < store.len; ++i) {
+        const Order *o = &store.rows[i];
+        if (store_dead(i)) continue;
+        if (row_is_line(o)) {
+            fputs(o->raw, out);
+            size_t n = strlen(o->raw);
+            if (n && o->raw[n-1] != '\n') fputc('\n', out);
+        } else {
+            write_order(out, o);
+        }
+    }
+
+    if (fclose(out) != 0) { perror("close tmp"); remove("orders.tmp"); return 0; }
+    TRACE_END(tw, "tmp write");
+    if (commit.mode != DURABLE_NONE && !commit_sync_path("orders.tmp")) { remove("orders.tmp"); return 0; }
+
+    // park the log first so a crash can tell which side of the swap it was on
+    TRACE_BEGIN(tr);
+    if (path_exists(WAL_FILE) && rename(WAL_FILE, WAL_FILE ".old") != 0) {
+        perror("park log"); remove("orders.tmp"); return 0;
+    }
+    if (remove(CSV_FILE) != 0) { perror("remove original"); checkpoint_recover(); return 0; }
+    if (rename("orders.tmp", CSV_FILE) != 0) { perror("rename tmp->csv"); return 0; }
+    remove(WAL_FILE ".old");
+    TRACE_END(tr, "rename");
+    return 1;
+}
+
+// full rewrite. Waits for a compaction in any process (orders.tmp is shared),
+// then keeps the others out until the swap is done.
+static int store_checkpoint(void) {
+    compact_wait();
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    if (!lock_range(LK_EXCL, LOCK_COMPACT, 1)) return 0;
+    int ok = 0;
+    if (store_lock(LK_EXCL)) {
+        ok = store_sync() && checkpoint_write();
+        if (ok) lock_gen_bump();
+        // positions changed: reload the compacted table
+        if (ok) ok = store_read();
+        store_unlock();
+    }
+    lock_range(LK_NONE, LOCK_COMPACT, 1);
+    if (!ok) return 0;
+    STAT_COUNT(CT_REWRITES, 1);
+    STAT_COUNT(CT_BYTES_WRITTEN, store.csv_size);
+    STAT_STOP(OP_CHECKPOINT, t0);
+    TRACE_END(tr, "checkpoint");
+    return 1;
+}
+
+/* Background compaction: merge CSV + log into a fresh snapshot off the main thread */
+
+// The worker only reads the CSV and the log up to the sizes they had when it
+// started, and only writes orders.tmp. Rows added and edits logged meanwhile
+// are carried over when the main thread installs the snapshot.
+
+typedef struct {
+    size_t pos, seq;
+    char *row;      // replacement line, NULL = deleted
+} MergeEntry;
+
+typedef struct {
+    long csv_end, wal_end;      // snapshot bounds
+    size_t *dropped;            // positions deleted by the merged log, sorted
+    size_t ndropped;
+    unsigned long loads;        // store.loads at the snapshot
+    int ok;
+} Compaction;
+
+static Compaction compaction;
+static int compact_running;
+#ifndef _WIN32
+static pthread_t compact_thread;
+static pthread_mutex_t compact_lock = PTHREAD_MUTEX_INITIALIZER;
+static int compact_finished;
+#endif
+
+static int cmp_merge_entry(const void *a, const void *b) {
+    const MergeEntry *x = a, *y = b;
+    if (x->pos != y->pos) return x->pos < y->pos ? -1 : 1;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+// latest log record per position, sorted by position
+static MergeEntry *compact_read_log(long wal_end, size_t *count) {
+    MergeEntry *ents = NULL;
+    size_t n = 0, cap = 0;
+    *count = 0;
+    FILE *f = fopen(WAL_FILE, "r");
+    if (!f) return NULL;
+
+    char line[512];
+    while (ftell(f) < wal_end && fgets(line, sizeof line, f)) {
+        unsigned long pos;
+        int off = 0;
+        char *row = NULL;
+        if (line[0] == 'D' && sscanf(line, "D,%lu", &pos) == 1) {
+            /* delete */
+        } else if (line[0] == 'U' && sscanf(line, "U,%lu,%n", &pos, &off) == 1 && off > 0) {
+            if (!(row = dup_str(line + off))) break;
+        } else {
+            break;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 256;
+            MergeEntry *p = realloc(ents, cap * sizeof *p);
+            if (!p) { free(row); break; }
+            ents = p;
+        }
+        ents[n].pos = pos;
+        ents[n].seq = n;
+        ents[n].row = row;
+        n++;
+    }
+    fclose(f);
+    if (!n) return ents;
+
+    qsort(ents, n, sizeof *ents, cmp_merge_entry);
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i + 1 < n && ents[i + 1].pos == ents[i].pos) { free(ents[i].row); continue; }
+        ents[k++] = ents[i];
+    }
+    *count = k;
+    return ents;
+}
+
+static void compact_run(Compaction *c) {
+    TRACE_BEGIN(tr);
+    size_t nents, next = 0, cap = 0;
+    MergeEntry *ents = compact_read_log(c->wal_end, &nents);
+
+    LineReader in;
+    int opened = reader_open(&in, CSV_FILE, (size_t)c->csv_end);
+    FILE *out = opened ? fopen("orders.tmp", "wb") : NULL;
+    if (!out) {
+        if (opened) reader_close(&in);
+        for (size_t i = 0; i < nents; ++i) free(ents[i].row);
+        free(ents);
+        return;
+    }
+
+    // same line walk as store_load, so positions line up
+    const char *line;
+    size_t len, off, pos = 0;
+    int first = 1;
+    while (reader_next(&in, &line, &len, &off)) {
+        if (first) {
+            char buf[512];
+            first = 0;
+            if (!line_to_buf(line, len, buf, sizeof buf) || !line_starts_with_digit(buf)) {
+                fwrite(line, 1, len, out);
+                continue;
+            }
+        }
+        while (next < nents && ents[next].pos < pos) next++;
+        if (next < nents && ents[next].pos == pos) {
+            if (!ents[next].row) {
+                if (c->ndropped == cap) {
+                    cap = cap ? cap * 2 : 256;
+                    size_t *p = realloc(c->dropped, cap * sizeof *p);
+                    if (!p) break;
+                    c->dropped = p;
+                }
+                c->dropped[c->ndropped++] = pos++;
+                continue;
+            }
+            line = ents[next].row;
+            len = strlen(line);
+        }
+        fwrite(line, 1, len, out);
+        if (len && line[len-1] != '\n') fputc('\n', out);
+        pos++;
+    }
+    c->ok = !ferror(out);
+    reader_close(&in);
+    if (fclose(out) != 0) c->ok = 0;
+    TRACE_END(tr, "tmp write");
+
+    for (size_t i = 0; i < nents; ++i) free(ents[i].row);
+    free(ents);
+}
+
+#ifndef _WIN32
+static void *compact_main(void *arg) {
+    compact_run(arg);
+    pthread_mutex_lock(&compact_lock);
+    compact_finished = 1;
+    pthread_mutex_unlock(&compact_lock);
+    return NULL;
+}
+#endif
+
+static void compact_reset(void) {
+    free(compaction.dropped);
+    memset(&compaction, 0, sizeof compaction);
+    compact_running = 0;
+}
+
+// new position of a row that survived the snapshot
+static size_t compact_remap(size_t pos) {
+    size_t lo = 0, hi = compaction.ndropped;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compaction.dropped[mid] < pos) lo = mid + 1; else hi = mid;
+    }
+    return pos - lo;
+}
+
+static int copy_file_tail(const char *src, long from, FILE *out) {
+    FILE *in = fopen(src, "rb");
+    if (!in) return 0;
+    char buf[1 << 16];
+    size_t n;
+    fseek(in, from, SEEK_SET);
+    while ((n = fread(buf, 1, sizeof buf, in)) > 0)
+        if (fwrite(buf, 1, n, out) != n) { fclose(in); return 0; }
+    fclose(in);
+    return 1;
+}
+
+// carry over what happened since the snapshot and swap files; the data lock is held
+static int compact_swap(void) {
+    const Compaction *c = &compaction;
+
+    // rows appended after the snapshot
+    TRACE_BEGIN(tw);
+    FILE *out = fopen("orders.tmp", "ab");
+    if (!out) { perror("orders.tmp"); return 0; }
+    int ok = copy_file_tail(CSV_FILE, c->csv_end, out);
+    if (fclose(out) != 0 || !ok) { perror("compact"); remove("orders.tmp"); return 0; }
+    TRACE_END(tw, "tmp write");
+    if (commit.mode != DURABLE_NONE && !commit_sync_path("orders.tmp")) { remove("orders.tmp"); return 0; }
+
+    // log records written after the snapshot, renumbered
+    FILE *in = fopen(WAL_FILE, "r");
+    FILE *nw = fopen(WAL_FILE ".next", "w");
+    if (!nw) { perror(WAL_FILE ".next"); if (in) fclose(in); remove("orders.tmp"); return 0; }
+    if (in) {
+        char line[512];
+        fseek(in, c->wal_end, SEEK_SET);
+        while (fgets(line, sizeof line, in)) {
+            unsigned long pos;
+            int off = 0;
+            char kind = line[0];
+            if ((kind != 'U' && kind != 'D') || sscanf(line + 1, ",%lu%n", &pos, &off) != 1) break;
+            fprintf(nw, "%c,%lu%s", kind, (unsigned long)compact_remap(pos), line + 1 + off);
+        }
+        fclose(in);
+    }
+    long nbytes = ftell(nw);
+    if (fclose(nw) != 0) { perror(WAL_FILE ".next"); remove(WAL_FILE ".next"); remove("orders.tmp"); return 0; }
+
+    // same parking order as a checkpoint; checkpoint_recover() knows .next
+    TRACE_BEGIN(tr);
+    if (path_exists(WAL_FILE) && rename(WAL_FILE, WAL_FILE ".old") != 0) {
+        perror("park log"); remove(WAL_FILE ".next"); remove("orders.tmp"); return 0;
+    }
+    if (remove(CSV_FILE) != 0) { perror("remove original"); checkpoint_recover(); return 0; }
+    if (rename("orders.tmp", CSV_FILE) != 0) { perror("rename tmp->csv"); return 0; }
+    if (rename(WAL_FILE ".next", WAL_FILE) != 0) { perror("install log"); return 0; }
+    remove(WAL_FILE ".old");
+    TRACE_END(tr, "rename");
+
+    // drop the merged tombstones from memory and renumber the rest
+    size_t k = 0, d = 0;
+    for (size_t i = 0; i < store.len; ++i) {
+        int dead = store_dead(i);
+        store_mark(i, 0);
+        if (d < c->ndropped && c->dropped[d] == i) { free(store.rows[i].raw); d++; continue; }
+        store_mark(k, dead);
+        store.rows[k++] = store.rows[i];
+    }
+    store.len = k;
+    store.ndeleted -= c->ndropped;
+    store.wal_bytes = nbytes;
+    store.retouch = 1;
+    dates_reset();
+    grams_reset();
+    fold_build();
+    idx_free(&store.ids);
+    for (size_t i = 0; i < store.len; ++i)
+        if (!row_is_line(&store.rows[i]) && !store_dead(i)) idx_insert(&store.ids, store.rows[i].orderid, i);
+    return 1;
+}
+
+// main thread: other processes may have appended since the snapshot, which
+// the swap carries over; if the table had to be read again it is stale
+static int compact_install(void) {
+    if (!compaction.ok) { remove("orders.tmp"); return 0; }
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    if (!store_lock(LK_EXCL)) { remove("orders.tmp"); return 0; }
+    int ok = store_sync() && compaction.loads == store.loads;
+    if (!ok) remove("orders.tmp");
+    else if ((ok = compact_swap()) != 0) store.gen = lock_gen_bump();
+    store_mark_seen();
+    store_unlock();
+    if (!ok) return 0;
+    // the merge ran in the background; what callers wait for is the swap
+    STAT_COUNT(CT_REWRITES, 1);
+    STAT_COUNT(CT_BYTES_WRITTEN, store.csv_size);
+    STAT_STOP(OP_COMPACT, t0);
+    TRACE_END(tr, "compaction");
+    return 1;
+}
+
+// install, then let any process compact again
+static void compact_finish(void) {
+    compact_install();
+    compact_reset();
+    lock_range(LK_NONE, LOCK_COMPACT, 1);
+}
+
+static int compact_start(void) {
+    if (compact_running || store.csv_size == 0) return 0;
+    // orders.tmp belongs to whoever holds this; another process is compacting
+    if (!lock_range(LK_EXCL, LOCK_COMPACT, 0)) return 0;
+
+    compact_reset();
+    compaction.csv_end = (long)store.csv_size;
+    compaction.wal_end = store.wal_bytes;
+    compaction.loads = store.loads;
+    compact_running = 1;
+#ifndef _WIN32
+    compact_finished = 0;
+    if (pthread_create(&compact_thread, NULL, compact_main, &compaction) == 0) return 1;
+#endif
+    // no threads: compact inline
+    compact_run(&compaction);
+    compact_finish();
+    return 1;
+}
+
+// install a finished snapshot; never blocks
+static void compact_poll(void) {
+#ifndef _WIN32
+    if (!compact_running || store_writing) return;  // installing takes the data lock itself
+    pthread_mutex_lock(&compact_lock);
+    int done = compact_finished;
+    pthread_mutex_unlock(&compact_lock);
+    if (!done) return;
+    pthread_join(compact_thread, NULL);
+    compact_finish();
+#endif
+}
+
+static void compact_wait(void) {
+#ifndef _WIN32
+    if (!compact_running) return;
+    pthread_join(compact_thread, NULL);
+    compact_finish();
+#endif
+}
+
+static void compact_maybe_start(void) {
+    compact_poll();
+    if (compact_running) return;
+    int big_log = store.wal_bytes > COMPACT_WAL_BYTES;
+    int many_tombs = store.ndeleted >= COMPACT_MIN_TOMBS
+                     && (double)store.ndeleted > COMPACT_TOMB_RATIO * (double)store.len;
+    if (big_log || many_tombs) compact_start();
+}
+
+static int orderIDExists(int target) {
+    if (!store_ensure_loaded()) return 0;
+    return idx_first(&store.ids, target) != ID_EMPTY;
+}
+
+/* Sidecar index file: OrderID -> byte offset, for one-off lookups */
+
+#define IDX_MAGIC "ORDIDX1"
+
+typedef struct {
+    char magic[8];
+    int64_t csv_size, csv_mtime;    // CSV identity when the index was built
+    int64_t count;
+} IdxFileHeader;
+
+typedef struct {
+    int32_t id, pad;
+    int64_t offset;
+} IdxFileEntry;
+
+static int cmp_idx_entry(const void *a, const void *b) {
+    const IdxFileEntry *x = a, *y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int csv_identity(int64_t *size, int64_t *mtime) {
+    struct stat st;
+    if (stat(CSV_FILE, &st) != 0) return 0;
+    *size = (int64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return 1;
+}
+
+// one scan of the CSV, entries sorted by (id, offset), written via tmp + rename
+static int idx_file_build(void) {
+    LineReader r;
+    if (!reader_open(&r, CSV_FILE, (size_t)-1)) { perror(CSV_FILE); return 0; }
+
+    IdxFileHeader h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, IDX_MAGIC, sizeof IDX_MAGIC);
+    if (!csv_identity(&h.csv_size, &h.csv_mtime)) { reader_close(&r); return 0; }
+
+    IdxFileEntry *ents = NULL;
+    size_t n = 0, cap = 0;
+    const char *line;
+    size_t len, off;
+    while (reader_next(&r, &line, &len, &off)) {
+        CsvRow cr;
+        if (csv_tokenize(line, len, &cr)) {
+            if (n == cap) {
+                cap = cap ? cap * 2 : 1024;
+                IdxFileEntry *p = realloc(ents, cap * sizeof *p);
+                if (!p) { perror("index"); free(ents); reader_close(&r); return 0; }
+                ents = p;
+            }
+            ents[n].id = cr.orderid;
+            ents[n].pad = 0;
+            ents[n].offset = (int64_t)off;
+            n++;
+        }
+    }
+    reader_close(&r);
+    if (n) qsort(ents, n, sizeof *ents, cmp_idx_entry);
+    h.count = (int64_t)n;
+
+    FILE *out = fopen(IDX_FILE ".tmp", "wb");
+    if (!out) { perror(IDX_FILE ".tmp"); free(ents); return 0; }
+    int ok = fwrite(&h, sizeof h, 1, out) == 1 && (n == 0 || fwrite(ents, sizeof *ents, n, out) == n);
+    free(ents);
+    if (fclose(out) != 0 || !ok) { perror("write index"); remove(IDX_FILE ".tmp"); return 0; }
+    remove(IDX_FILE);
+    if (rename(IDX_FILE ".tmp", IDX_FILE) != 0) { perror("rename index"); return 0; }
+    return 1;
+}
+
+// open the index if it still describes the current CSV
+static FILE *idx_file_open(IdxFileHeader *h) {
+    int64_t size, mtime;
+    if (!csv_identity(&size, &mtime)) return NULL;
+    FILE *f = fopen(IDX_FILE, "rb");
+    if (!f) return NULL;
+    if (fread(h, sizeof *h, 1, f) != 1 || memcmp(h->magic, IDX_MAGIC, sizeof IDX_MAGIC) != 0
+        || h->csv_size != size || h->csv_mtime != mtime || h->count < 0) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+// 1 found, 0 not found, -1 index unusable
+static int idx_file_search(int id, Order *out) {
+    IdxFileHeader h;
+    FILE *f = idx_file_open(&h);
+    if (!f) return -1;
+
+    // lower bound over entries on disk
+    int64_t lo = 0, hi = h.count;
+    IdxFileEntry e;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (fseek(f, (long)(sizeof h + mid * sizeof e), SEEK_SET) != 0 || fread(&e, sizeof e, 1, f) != 1) {
+            fclose(f); return -1;
+        }
+        if (e.id < id) lo = mid + 1; else hi = mid;
+    }
+    int rc = 0;
+    if (lo < h.count) {
+        if (fseek(f, (long)(sizeof h + lo * sizeof e), SEEK_SET) != 0 || fread(&e, sizeof e, 1, f) != 1) rc = -1;
+        else if (e.id == id) rc = 1;
+    }
+    fclose(f);
+    if (rc != 1) return rc;
+
+    // jump straight to the line and double-check it
+    FILE *csv = fopen(CSV_FILE, "rb");
+    if (!csv) return -1;
+    char line[512];
+    memset(out, 0, sizeof *out);
+    if (fseek(csv, (long)e.offset, SEEK_SET) != 0 || !fgets(line, sizeof line, csv)
+        || !order_from_line(line, strlen(line), out) || out->orderid != id) {
+        free(out->raw);
+        out->raw = NULL;
+        rc = -1;
+    }
+    fclose(csv);
+    return rc;
+}
+
+// lookup without loading the store; rebuilds a missing or stale index once.
+// The caller frees out->raw (the date text of an order with date 0)
+static int idx_file_lookup(int id, Order *out) {
+    struct stat st;
+    if (stat(WAL_FILE, &st) == 0 && st.st_size > 0) {
+        // pending log records are not in the CSV yet: answer from memory
+        if (!store_ensure_loaded()) return 0;
+        size_t pos = idx_first(&store.ids, id);
+        if (pos == ID_EMPTY) return 0;
+        *out = store.rows[pos];
+        return !out->raw || (out->raw = dup_str(out->raw)) != NULL;
+    }
+    if (!store_lock(LK_SHARED)) return 0;
+    int rc = idx_file_search(id, out);
+    store_unlock();
+    if (rc >= 0) return rc;
+    // one process rebuilds the index at a time
+    if (!store_lock(LK_EXCL)) return 0;
+    rc = idx_file_search(id, out);
+    if (rc < 0) rc = idx_file_build() && idx_file_search(id, out) == 1;
+    store_unlock();
+    return rc;
+}
+
+/* Order operations shared by the menu and batch mode */
+
+// callers hold store_write_begin()
+
+static int same_order(size_t pos, const Order *b) {
+    const Order *a = &store.rows[pos];
+    return !row_is_line(a) && !store_dead(pos) && a->orderid == b->orderid && a->qty == b->qty
+        && a->price == b->price && a->date == b->date
+        && strcmp(a->customer, b->customer) == 0 && strcmp(a->product, b->product) == 0;
+}
+
+// where the row shown to the user as *seen is now: pos if still the same,
+// else an identical row with its OrderID (a swap renumbers rows); ID_EMPTY
+// once another process changed or deleted it
+static size_t order_locate(size_t pos, const Order *seen) {
+    if (pos < store.len && same_order(pos, seen)) return pos;
+    size_t *hits, n = idx_matches(&store.ids, seen->orderid, &hits), at = ID_EMPTY;
+    for (size_t i = 0; i < n && at == ID_EMPTY; ++i)
+        if (same_order(hits[i], seen)) at = hits[i];
+    free(hits);
+    return at;
+}
+
+static int order_add(const Order *o) {
+    char line[256];
+    int n = format_order(line, sizeof line, o);
+    return commit_put(&commit.csv, line, (size_t)n) && store_append(o) != NULL;
+}
+
+// one small append per edit; the CSV itself is rewritten only at checkpoints
+static int order_update(size_t pos, const Order *o) {
+    Order row = *o;
+    if (!row.date) row.raw = store.rows[pos].raw;   // o's may predate a reload
+    if (!wal_append_update(pos, &row)) return 0;
+    store_set(pos, &row);
+    return 1;
+}
+
+static int order_delete(size_t pos) {
+    if (!wal_append_delete(pos)) return 0;
+    store_remove(pos);
+    return 1;
+}
+
+// live orders whose product contains needle_lc, in file order; caller frees *out
+static size_t product_matches(const char *needle_lc, size_t **out) {
+    TRACE_BEGIN(tr);
+    // shortlist from the trigram index; short needles scan the folded column
+    uint32_t *cand;
+    size_t n = (size_t)-1, k = 0;
+    *out = NULL;
+    if (strlen(needle_lc) >= 3 && (store.grams.built || grams_build()))
+        n = grams_candidates(needle_lc, &cand);
+    if (n == (size_t)-1) {
+        k = fold_scan(needle_lc, out);
+        STAT_COUNT(CT_ROWS_SCANNED, store.len);
+        STAT_COUNT(CT_ROWS_MATCHED, k);
+        TRACE_END(tr, "match");
+        return k;
+    }
+
+    *out = malloc((n ? n : 1) * sizeof **out);
+    if (!*out) perror("search");
+    else
+        for (size_t i = 0; i < n; ++i)
+            if (strstr(fold_name(cand[i]), needle_lc)) (*out)[k++] = cand[i];
+    free(cand);
+    STAT_COUNT(CT_ROWS_SCANNED, n);
+    STAT_COUNT(CT_ROWS_MATCHED, k);
+    TRACE_END(tr, "match");
+    return k;
+}
+
+/* Features */
+
+static void Addcsv(void) {
+    ensure_csv_header();
+    if (!store_ensure_loaded()) return;
+
+    Order o;
+    memset(&o, 0, sizeof o);
+
+    // unique id
+    for (;;) {
+        read_int_loop("Enter Order ID: ", &o.orderid, 0, 0);
+        if (!orderIDExists(o.orderid)) break;
+        printf("Order ID %d already exists. Try another.\n", o.orderid);
+    }
+
+    //valid data type
+    read_text_loop("Customer name: ", o.customer, sizeof o.customer);
+    read_text_loop("Product name: ",  o.product,  sizeof o.product);
+    read_int_loop ("Quantity (>=0): ", &o.qty, 1, 0);
+    read_float_loop("Price (>=0): ", &o.price, 1, 0.0f);
+    char date[20];
+    read_date_loop ("Order date (DD-MM-YYYY): ", date, sizeof date);
+    o.date = date_pack(date, strlen(date));
+
+    // someone else may have taken the ID while we were typing
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    if (!store_write_begin()) return;
+    int taken = idx_first(&store.ids, o.orderid) != ID_EMPTY;
+    int ok = !taken && order_add(&o);
+    ok = store_write_end() && ok;
+    STAT_STOP(OP_ADD, t0);
+    TRACE_END(tr, "add");
+    if (taken) { printf("Order ID %d was just added by another user. Nothing saved.\n", o.orderid); return; }
+    if (!ok) return;
+    date_format(o.date, date, sizeof date);
+    printf("Added: %d,%s,%s,%d,%.2f,%s\n", o.orderid, o.customer, o.product, o.qty, o.price, date);
+}
+
+static void searchByOrderID(void) {
+    if (!store_ensure_loaded()) return;
+
+    int id;
+    read_int_loop("Enter Order ID to search: ", &id, 0, 0);
+
+    if (!store.header && store.len == 0) { printf("No data.\n"); return; }
+
+    STAT_START(t0);
+    size_t pos = idx_first(&store.ids, id);
+    STAT_STOP(OP_GET, t0);
+    STAT_COUNT(CT_ROWS_MATCHED, pos != ID_EMPTY);
+    if (pos != ID_EMPTY) print_order("Found: ", &store.rows[pos]);
+    else printf("OrderID %d not found.\n", id);
+}
+
+static void searchByProductName(void) {
+    if (!store_ensure_loaded()) return;
+
+    char needle[64];
+    read_text_loop("Enter product name (substring, case-insensitive): ", needle, sizeof needle);
+
+    char needle_lc[64];
+    strncpy(needle_lc, needle, sizeof needle_lc - 1);
+    needle_lc[sizeof needle_lc - 1] = '\0';
+    lowercase(needle_lc);
+
+    if (!store.header && store.len == 0) { printf("No data.\n"); return; }
+
+    size_t *hits;
+    STAT_START(t0);
+    size_t n = product_matches(needle_lc, &hits);
+    STAT_STOP(OP_FIND, t0);
+    for (size_t k = 0; k < n; ++k) {
+        if (!k) printf("Matches for \"%s\":\n", needle);
+        print_order("", &store.rows[hits[k]]);
+    }
+    free(hits);
+
+    if (!n) printf("No orders found for product containing \"%s\".\n", needle);
+}
+
+static void searchByDateRange(void) {
+    if (!store_ensure_loaded()) return;
+
+    char from_s[20], to_s[20];
+    read_date_loop("From date (DD-MM-YYYY): ", from_s, sizeof from_s);
+    read_date_loop("To date   (DD-MM-YYYY): ", to_s, sizeof to_s);
+    uint32_t from = date_pack(from_s, strlen(from_s)), to = date_pack(to_s, strlen(to_s));
+    if (from > to) { uint32_t t = from; from = to; to = t; }
+
+    if (!store.header && store.len == 0) { printf("No data.\n"); return; }
+    STAT_START(t0);
+    if (!store.dates.built && !dates_build()) return;
+
+    char a[16], b[16];
+    date_format(from, a, sizeof a);
+    date_format(to, b, sizeof b);
+
+    size_t first, n = dates_range(from, to, &first), live = 0;
+    for (size_t i = first; i < first + n; ++i) live += !store_dead(store.dates.pos[i]);
+    STAT_STOP(OP_RANGE, t0);
+    STAT_COUNT(CT_ROWS_SCANNED, n);
+    STAT_COUNT(CT_ROWS_MATCHED, live);
+    if (!live) { printf("No orders between %s and %s.\n", a, b); return; }
+    printf("Orders from %s to %s (%lu):\n", a, b, (unsigned long)live);
+    for (size_t i = first; i < first + n; ++i)
+        if (!store_dead(store.dates.pos[i])) print_order("", &store.rows[store.dates.pos[i]]);
+}
+
+static void updateOrderByID(void) {
+    if (!store_ensure_loaded()) return;
+
+    int target;
+    read_int_loop("Enter Order ID to update: ", &target, 0, 0);
+
+    if (!store.header && store.len == 0) { printf("File is empty.\n"); return; }
+
+    size_t *hits;
+    size_t found = idx_matches(&store.ids, target, &hits);
+    for (size_t i = 0; i < found; ++i) {
+        Order seen = store.rows[hits[i]], o = seen;
+        print_order("Current: ", &o);
+
+        //optional edits
+        if (read_optional_text ("New customer name (leave blank to keep): ", o.customer, sizeof o.customer)) { /* ok */ }
+        if (read_optional_text ("New product name  (leave blank to keep): ", o.product,  sizeof o.product))  { /* ok */ }
+
+        int new_qty;
+        if (read_optional_int("New quantity (leave blank to keep): ", &new_qty)) {
+            if (new_qty < 0) printf("Quantity must be >= 0. Keeping old value.\n");
+            else o.qty = new_qty;
+        }
+
+        float new_price;
+        if (read_optional_float("New price (leave blank to keep): ", &new_price)) {
+            if (new_price < 0.f) printf("Price must be >= 0. Keeping old value.\n");
+            else o.price = new_price;
+        }
+
+        char date[20];
+        if (read_optional_date("New order date DD-MM-YYYY (leave blank to keep): ", date, sizeof date))
+            o.date = date_pack(date, strlen(date));
+
+        STAT_START(t0);
+        TRACE_BEGIN(tr);
+        if (!store_write_begin()) { free(hits); return; }
+        size_t at = order_locate(hits[i], &seen);
+        int ok = at != ID_EMPTY && order_update(at, &o);
+        ok = store_write_end() && ok;
+        STAT_STOP(OP_UPDATE, t0);
+        TRACE_END(tr, "update");
+        if (at == ID_EMPTY) {
+            printf("Order %d was changed by another user meanwhile. No changes made.\n", target);
+            free(hits);
+            return;
+        }
+        if (!ok) { free(hits); return; }
+    }
+    free(hits);
+
+    if (!found) {
+        printf("OrderID %d not found. No changes made.\n", target);
+        return;
+    }
+
+    printf("Order %d updated successfully.\n", target);
+    compact_maybe_start();
+}
+
+
+static void deleteByOrderID(void) {
+    if (!store_ensure_loaded()) return;
+
+    int target;
+    read_int_loop("Enter Order ID to delete: ", &target, 0, 0);
+
+    if (!store.header && store.len == 0) { printf("No data.\n"); return; }
+
+    // collect matches so user can choose which one to delete
+    size_t *found;
+    int matches = (int)idx_matches(&store.ids, target, &found);
+
+    if (matches == 0) {
+        printf("OrderID %d not found. Nothing to delete.\n", target);
+        return;
+    }
+
+    printf("\nFound %d record(s) with OrderID %d:\n", matches, target);
+    for (int i = 0; i < matches; ++i) {
+        char prefix[32];
+        snprintf(prefix, sizeof prefix, "  [%d] ", i + 1);
+        print_order(prefix, &store.rows[found[i]]);
+    }
+
+    // Choose which matching line to delete
+    int choice_index = 1;
+    if (matches > 1) {
+        for (;;) {
+            if (read_int_loop("Choose which one to delete [1..N]: ", &choice_index, 1, 1)) {
+                if (choice_index >= 1 && choice_index <= matches) break;
+            }
+            printf("Please choose a number between 1 and %d.\n", matches);
+        }
+    }
+
+    // Confirm deletion
+    char confirm[16];
+    read_line("Confirm delete? (Y/N): ", confirm, sizeof confirm);
+    if (!(confirm[0] == 'Y' || confirm[0] == 'y')) {
+        free(found);
+        printf("Canceled. No changes made.\n");
+        return;
+    }
+
+    size_t pos = found[choice_index - 1];
+    Order seen = store.rows[pos];
+    free(found);
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    if (!store_write_begin()) return;
+    size_t at = order_locate(pos, &seen);
+    int ok = at != ID_EMPTY && order_delete(at);
+    ok = store_write_end() && ok;
+    STAT_STOP(OP_DELETE, t0);
+    TRACE_END(tr, "delete");
+    if (at == ID_EMPTY) { printf("Order %d was changed by another user meanwhile. No changes made.\n", target); return; }
+    if (!ok) return;
+
+    printf("Deleted record [%d] for OrderID %d successfully.\n", choice_index, target);
+    compact_maybe_start();
+}
+
+
+/* Bulk import: reader -> parser workers -> ordered writer, joined by SPSC rings */
+
+#define IMPORT_SHOW_MAX 20          // rejected lines echoed one by one, the rest only counted
+#define IMPORT_RING     4           // blocks in flight per parser, each way
+
+static size_t import_block_bytes = 1 << 20;     // whole lines handed to a parser at a time
+
+// same rules as the Addcsv prompts; NULL if the row is good, else why not
+static const char *import_check(char *line, Order *o) {
+    char *f[6];
+    size_t n = 0;
+    for (char *p = line; n < 6; ) {
+        f[n++] = p;
+        if (!(p = strchr(p, ','))) break;
+        *p++ = '\0';
+    }
+    if (n != 6 || strchr(f[5], ',')) return "expected 6 fields";
+    if (!try_parse_int(f[0], &o->orderid)) return "bad order id";
+    if (!f[1][0] || !f[2][0]) return "empty name";
+    if (strlen(f[1]) >= sizeof o->customer || strlen(f[2]) >= sizeof o->product) return "name too long";
+    if (!try_parse_int(f[3], &o->qty) || o->qty < 0) return "bad quantity";
+    if (!try_parse_float(f[4], &o->price) || o->price < 0.f) return "bad price";
+    if (!is_valid_date_str(f[5])) return "bad date";
+    strcpy(o->customer, f[1]);
+    strcpy(o->product, f[2]);
+    o->date = date_pack(f[5], strlen(f[5]));
+    return NULL;
+}
+
+typedef struct {
+    Order o;
+    unsigned long line;     // within the block, from 1
+} ImportRow;
+
+typedef struct {
+    unsigned long line;
+    const char *why;
+} ImportReject;
+
+typedef struct {
+    char *data;
+    size_t len;             // whole lines only
+    int first;              // starts at line 1 of the file
+    unsigned long nlines;
+    ImportRow *rows;        // valid rows; duplicates are the writer's call
+    size_t nrows, rows_cap;
+    ImportReject *rej;
+    size_t nrej, rej_cap;
+    int failed;
+} ImportBlock;
+
+typedef struct {
+    FILE *f;
+    char *carry;            // partial last line of the previous block
+    size_t ncarry, carry_cap;
+    int eof, failed, started;
+    size_t bytes;
+} ImportReader;
+
+typedef struct {
+    char *out;              // accepted rows as CSV text, written once at the end
+    size_t len, cap;
+    unsigned long lines, imported, rejected;
+    struct { const char *why; unsigned long count; } tally[8];
+    size_t nkinds;
+    int ok;
+} ImportState;
+
+static double now_seconds(void) {
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void import_free_block(ImportBlock *b) {
+    if (!b) return;
+    free(b->data);
+    free(b->rows);
+    free(b->rej);
+    free(b);
+}
+
+// next run of whole lines, NULL at end of file
+static ImportBlock *import_next_block(ImportReader *rd) {
+    if (rd->eof) return NULL;
+    size_t cap = import_block_bytes > rd->ncarry * 2 ? import_block_bytes : rd->ncarry * 2;
+    ImportBlock *b = calloc(1, sizeof *b);
+    char *buf = malloc(cap);
+    if (!b || !buf) { perror("import"); free(b); free(buf); rd->failed = rd->eof = 1; return NULL; }
+    if (rd->ncarry) memcpy(buf, rd->carry, rd->ncarry);
+
+    size_t len = rd->ncarry, keep = 0;
+    for (;;) {
+        len += fread(buf + len, 1, cap - len, rd->f);
+        if (len < cap) {
+            if (ferror(rd->f)) { perror("import"); rd->failed = 1; }
+            rd->eof = 1;
+            break;
+        }
+        size_t end = len;
+        while (end && buf[end-1] != '\n') end--;
+        if (end) { keep = len - end; len = end; break; }
+        char *p = realloc(buf, cap * 2);    // a line longer than the block
+        if (!p) { perror("import"); rd->failed = rd->eof = 1; break; }
+        buf = p;
+        cap *= 2;
+    }
+    if (keep && !grow_array((void **)&rd->carry, &rd->carry_cap, keep, 1)) { rd->failed = rd->eof = 1; keep = 0; }
+    if (keep) memcpy(rd->carry, buf + len, keep);
+    rd->ncarry = keep;
+
+    if (!len) { free(buf); free(b); return NULL; }
+    b->data = buf;
+    b->len = len;
+    b->first = !rd->started;
+    rd->started = 1;
+    rd->bytes += len;
+    return b;
+}
+
+static void import_parse_block(ImportBlock *b) {
+    TRACE_BEGIN(tr);
+    const char *p = b->data, *end = b->data + b->len;
+    while (p < end && !b->failed) {
+        const char *line = p, *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t n = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+        char buf[512];
+        const char *why = NULL;
+        Order o;
+        memset(&o, 0, sizeof o);
+        p += n;
+        b->nlines++;
+        if (!line_to_buf(line, n, buf, sizeof buf)) {
+            why = "line too long";
+        } else {
+            chomp(buf);
+            if (!buf[0]) continue;
+            if (b->first && b->nlines == 1 && !line_starts_with_digit(buf)) continue;  // header
+            why = import_check(buf, &o);
+        }
+        if (why) {
+            if (!grow_array((void **)&b->rej, &b->rej_cap, b->nrej + 1, sizeof *b->rej)) { b->failed = 1; break; }
+            b->rej[b->nrej].line = b->nlines;
+            b->rej[b->nrej++].why = why;
+        } else {
+            if (!grow_array((void **)&b->rows, &b->rows_cap, b->nrows + 1, sizeof *b->rows)) { b->failed = 1; break; }
+            b->rows[b->nrows].o = o;
+            b->rows[b->nrows++].line = b->nlines;
+        }
+    }
+    TRACE_END(tr, "parse");
+}
+
+static void import_reject(ImportState *st, unsigned long line, const char *why) {
+    if (st->rejected++ < IMPORT_SHOW_MAX) fprintf(stderr, "line %lu: %s\n", line, why);
+    size_t k = 0;
+    while (k < st->nkinds && st->tally[k].why != why) k++;
+    if (k == st->nkinds && st->nkinds < sizeof st->tally / sizeof *st->tally) {
+        st->tally[k].why = why;
+        st->tally[k].count = 0;
+        st->nkinds++;
+    }
+    if (k < st->nkinds) st->tally[k].count++;
+}
+
+// writer/indexer, blocks in file order: first occurrence of an ID wins
+static void import_commit(ImportState *st, ImportBlock *b) {
+    if (b->failed) st->ok = 0;
+    size_t i = 0, k = 0;
+    while (st->ok && (i < b->nrows || k < b->nrej)) {
+        // rows and rejects are each in line order; interleave so messages are too
+        if (k < b->nrej && (i == b->nrows || b->rej[k].line < b->rows[i].line)) {
+            import_reject(st, st->lines + b->rej[k].line, b->rej[k].why);
+            k++;
+            continue;
+        }
+        ImportRow *r = &b->rows[i++];
+        if (idx_first(&store.ids, r->o.orderid) != ID_EMPTY) {
+            import_reject(st, st->lines + r->line, "duplicate order id");
+            continue;
+        }
+        char line[256];
+        size_t n = (size_t)format_order(line, sizeof line, &r->o);
+        if (!grow_array((void **)&st->out, &st->cap, st->len + n, 1) || !store_append(&r->o)) { st->ok = 0; break; }
+        memcpy(st->out + st->len, line, n);
+        st->len += n;
+        st->imported++;
+    }
+    st->lines += b->nlines;
+}
+
+#ifndef _WIN32
+typedef struct {
+    ImportBlock *slot[IMPORT_RING];
+    char pad0[64];
+    size_t head;            // consumer side
+    char pad1[64];
+    size_t tail;            // producer side
+    char pad2[64];
+} Ring;
+
+// single producer, single consumer; a waiting side yields its core
+static void ring_push(Ring *r, ImportBlock *b) {
+    size_t t = r->tail;
+    while (t - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == IMPORT_RING) sched_yield();
+    r->slot[t % IMPORT_RING] = b;
+    __atomic_store_n(&r->tail, t + 1, __ATOMIC_RELEASE);
+}
+
+static ImportBlock *ring_pop(Ring *r) {
+    size_t h = r->head;
+    while (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == h) sched_yield();
+    ImportBlock *b = r->slot[h % IMPORT_RING];
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+    return b;
+}
+
+typedef struct {
+    ImportReader *rd;
+    Ring *in, *out;         // one of each per parser
+    size_t nworkers;
+} ImportPipe;
+
+typedef struct {
+    ImportPipe *pipe;
+    size_t id;
+} ImportWorker;
+
+// block k goes to parser k % n; NULL tells every parser the file is done
+static void *import_reader_main(void *arg) {
+    ImportPipe *pp = arg;
+    ImportBlock *b;
+    for (size_t k = 0; (b = import_next_block(pp->rd)) != NULL; ++k)
+        ring_push(&pp->in[k % pp->nworkers], b);
+    for (size_t i = 0; i < pp->nworkers; ++i) ring_push(&pp->in[i], NULL);
+    return NULL;
+}
+
+static void *import_worker_main(void *arg) {
+    ImportWorker *w = arg;
+    ImportBlock *b;
+    while ((b = ring_pop(&w->pipe->in[w->id])) != NULL) {
+        import_parse_block(b);
+        ring_push(&w->pipe->out[w->id], b);
+    }
+    ring_push(&w->pipe->out[w->id], NULL);
+    return NULL;
+}
+
+// returns the number of parsers used, 0 if the pipeline could not start
+static size_t import_pipeline(ImportReader *rd, ImportState *st) {
+    size_t n = scan_width() > 2 ? scan_width() - 2 : 1;
+    ImportPipe pp = { rd, calloc(n, sizeof(Ring)), calloc(n, sizeof(Ring)), n };
+    ImportWorker *w = calloc(n, sizeof *w);
+    pthread_t *tid = calloc(n + 1, sizeof *tid);
+    if (!pp.in || !pp.out || !w || !tid) { perror("import"); free(pp.in); free(pp.out); free(w); free(tid); return 0; }
+
+    size_t started = 0;
+    for (; started < n; ++started) {
+        w[started].pipe = &pp;
+        w[started].id = started;
+        if (pthread_create(&tid[started], NULL, import_worker_main, &w[started]) != 0) break;
+    }
+    int reading = started == n && pthread_create(&tid[n], NULL, import_reader_main, &pp) == 0;
+    if (!reading) {
+        // no reader: stop the parsers that did start
+        for (size_t i = 0; i < started; ++i) ring_push(&pp.in[i], NULL);
+        for (size_t i = 0; i < started; ++i) pthread_join(tid[i], NULL);
+        n = 0;
+    } else {
+        ImportBlock *b;
+        for (size_t k = 0; (b = ring_pop(&pp.out[k % n])) != NULL; ++k) {
+            import_commit(st, b);
+            import_free_block(b);
+        }
+        for (size_t i = 0; i <= n; ++i) pthread_join(tid[i], NULL);
+    }
+    free(pp.in);
+    free(pp.out);
+    free(w);
+    free(tid);
+    return n;
+}
+#endif
+
+static int import_csv(const char *path) {
+    ImportReader rd;
+    memset(&rd, 0, sizeof rd);
+    rd.f = fopen(path, "rb");
+    if (!rd.f) { perror(path); return 0; }
+    if (!store_ensure_loaded()) { fclose(rd.f); return 0; }
+    // duplicates are judged against the table as it is when the batch lands
+    STAT_START(stat_t0);
+    TRACE_BEGIN(tr);
+    if (!store_write_begin()) { fclose(rd.f); return 0; }
+
+    ImportState st;
+    memset(&st, 0, sizeof st);
+    st.ok = 1;
+    double t0 = now_seconds();
+    size_t parsers = 0;
+#ifndef _WIN32
+    parsers = import_pipeline(&rd, &st);
+#endif
+    if (!parsers) {     // same stages, one after another
+        ImportBlock *b;
+        while ((b = import_next_block(&rd)) != NULL) {
+            import_parse_block(b);
+            import_commit(&st, b);
+            import_free_block(b);
+        }
+        parsers = 1;
+    }
+    fclose(rd.f);
+    free(rd.carry);
+    if (rd.failed) st.ok = 0;
+
+    // nothing reaches the CSV unless the whole batch went through; the
+    // accepted rows become the pending append as they are
+    if (st.ok && st.len) {
+        free(commit.csv.buf);
+        commit.csv.buf = st.out;
+        commit.csv.len = st.len;
+        commit.csv.cap = st.cap;
+        st.out = NULL;
+    }
+    free(st.out);
+    if (!st.ok) store_read();   // drop rows indexed along the way
+    if (!store_write_end()) st.ok = 0;
+    if (!st.ok) return 0;
+    STAT_STOP(OP_IMPORT, stat_t0);
+    TRACE_END(tr, "import");
+    STAT_COUNT(CT_BYTES_READ, rd.bytes);
+    STAT_COUNT(CT_ROWS_SCANNED, st.lines);
+
+    double secs = now_seconds() - t0;
+    if (secs <= 0) secs = 1e-9;
+    printf("Imported %lu orders, rejected %lu lines.\n", st.imported, st.rejected);
+    for (size_t k = 0; k < st.nkinds; ++k) printf("  %s: %lu\n", st.tally[k].why, st.tally[k].count);
+    if (st.rejected > IMPORT_SHOW_MAX)
+        fprintf(stderr, "(%lu more rejected lines not listed)\n", st.rejected - IMPORT_SHOW_MAX);
+    printf("Read %.1f MB, %lu lines in %.2f s (%.1f MB/s, %.0f lines/s) with %lu parser thread(s).\n",
+           rd.bytes / 1e6, st.lines, secs, rd.bytes / 1e6 / secs, st.lines / secs, (unsigned long)parsers);
+    return 1;
+}
+
+
+/* Batch mode: one command per line, one status line per command */
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+    int failed;     // out of memory; the reply is incomplete
+} Reply;
+
+static void reply_put(Reply *r, const char *s, size_t n) {
+    if (r->failed || !grow_array((void **)&r->buf, &r->cap, r->len + n, 1)) { r->failed = 1; return; }
+    memcpy(r->buf + r->len, s, n);
+    r->len += n;
+}
+
+// "OK <n>" and then the n affected rows as CSV lines
+static void batch_reply(Reply *out, const size_t *pos, size_t n) {
+    char line[256];
+    reply_put(out, line, (size_t)snprintf(line, sizeof line, "OK %lu\n", (unsigned long)n));
+    for (size_t i = 0; i < n; ++i)
+        reply_put(out, line, (size_t)format_order(line, sizeof line, &store.rows[pos[i]]));
+}
+
+// UPDATE fields: id,customer,product,qty,price,date with blanks kept as they are
+static const char *batch_patch(char *args, int *id, Order *patch, unsigned *set) {
+    char *f[6];
+    size_t n = 0;
+    for (char *p = args; n < 6; ) {
+        f[n++] = p;
+        if (!(p = strchr(p, ','))) break;
+        *p++ = '\0';
+    }
+    *set = 0;
+    if (n != 6 || strchr(f[5], ',')) return "expected 6 fields";
+    if (!try_parse_int(f[0], id)) return "bad order id";
+    if (strlen(f[1]) >= sizeof patch->customer || strlen(f[2]) >= sizeof patch->product) return "name too long";
+    if (f[1][0]) { strcpy(patch->customer, f[1]); *set |= 1; }
+    if (f[2][0]) { strcpy(patch->product, f[2]); *set |= 2; }
+    if (f[3][0]) {
+        if (!try_parse_int(f[3], &patch->qty) || patch->qty < 0) return "bad quantity";
+        *set |= 4;
+    }
+    if (f[4][0]) {
+        if (!try_parse_float(f[4], &patch->price) || patch->price < 0.f) return "bad price";
+        *set |= 8;
+    }
+    if (f[5][0]) {
+        if (!is_valid_date_str(f[5])) return "bad date";
+        patch->date = date_pack(f[5], strlen(f[5]));
+        *set |= 16;
+    }
+    return NULL;
+}
+
+static const char *batch_command(const char *line, char *arg, Reply *out) {
+    size_t *hits = NULL, n;
+    int id;
+    if (strcmp(line, "ADD") == 0) {
+        Order o;
+        memset(&o, 0, sizeof o);
+        const char *why = import_check(arg, &o);
+        if (why) return why;
+        if (idx_first(&store.ids, o.orderid) != ID_EMPTY) return "duplicate order id";
+        if (!order_add(&o)) return "write failed";
+        size_t pos = store.len - 1;
+        batch_reply(out, &pos, 1);
+        return NULL;
+    }
+    if (strcmp(line, "GET") == 0) {
+        if (!try_parse_int(arg, &id)) return "bad order id";
+        n = idx_matches(&store.ids, id, &hits);
+        STAT_COUNT(CT_ROWS_MATCHED, n);
+        batch_reply(out, hits, n);
+        free(hits);
+        return NULL;
+    }
+    if (strcmp(line, "FIND") == 0) {
+        char needle_lc[64];
+        if (!arg[0]) return "empty search";
+        product_fold(arg, needle_lc, sizeof needle_lc);
+        n = product_matches(needle_lc, &hits);
+        batch_reply(out, hits, n);
+        free(hits);
+        return NULL;
+    }
+    if (strcmp(line, "UPDATE") == 0) {
+        Order patch;
+        unsigned set;
+        memset(&patch, 0, sizeof patch);
+        const char *why = batch_patch(arg, &id, &patch, &set);
+        if (why) return why;
+        n = idx_matches(&store.ids, id, &hits);
+        for (size_t i = 0; i < n; ++i) {
+            Order o = store.rows[hits[i]];
+            if (set & 1)  strcpy(o.customer, patch.customer);
+            if (set & 2)  strcpy(o.product, patch.product);
+            if (set & 4)  o.qty = patch.qty;
+            if (set & 8)  o.price = patch.price;
+            if (set & 16) o.date = patch.date;
+            if (!order_update(hits[i], &o)) { free(hits); return "write failed"; }
+        }
+        batch_reply(out, hits, n);
+        free(hits);
+        return NULL;
+    }
+    if (strcmp(line, "DELETE") == 0) {
+        // DELETE <id> [k]: the k-th record with that ID in file order, default 1
+        int k = 1;
+        char *sp = strchr(arg, ' ');
+        if (sp) {
+            *sp++ = '\0';
+            if (!try_parse_int(sp, &k) || k < 1) return "bad record number";
+        }
+        if (!try_parse_int(arg, &id)) return "bad order id";
+        n = idx_matches(&store.ids, id, &hits);
+        if ((size_t)k > n) { free(hits); return n ? "no such record" : "not found"; }
+        size_t pos = hits[k - 1];
+        free(hits);
+        if (!order_delete(pos)) return "write failed";
+        batch_reply(out, &pos, 1);
+        return NULL;
+    }
+    return "unknown command";
+}
+
+// run one command; NULL on success (reply written), else the error text.
+// Reads catch up under the shared lock, writes run under the exclusive one.
+static const char *batch_exec(char *line, Reply *out) {
+    char *arg = strchr(line, ' ');
+    if (arg) *arg++ = '\0';
+    else arg = line + strlen(line);
+
+    int op = strcmp(line, "ADD") == 0 ? OP_ADD : strcmp(line, "UPDATE") == 0 ? OP_UPDATE
+           : strcmp(line, "DELETE") == 0 ? OP_DELETE : strcmp(line, "GET") == 0 ? OP_GET
+           : strcmp(line, "FIND") == 0 ? OP_FIND : -1;
+    int writes = op == OP_ADD || op == OP_UPDATE || op == OP_DELETE;
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    if (!(writes ? store_write_begin() : store_refresh())) return "store unavailable";
+    size_t at = out->len;
+    const char *why = batch_command(line, arg, out);
+    if (!writes) {
+        if (op >= 0) STAT_STOP(op, t0);
+        TRACE_END(tr, op >= 0 ? stat_op_names[op] : "batch");
+        return why;
+    }
+    if (!store_write_end() && !why) { out->len = at; why = "write failed"; }
+    STAT_STOP(op, t0);
+    TRACE_END(tr, stat_op_names[op]);
+    if (!why && !store_writing) compact_maybe_start();     // never with the lock held
+    return why;
+}
+
+static void reply_error(Reply *out, const char *why) {
+    reply_put(out, "ERR ", 4);
+    reply_put(out, why, strlen(why));
+    reply_put(out, "\n", 1);
+}
+
+// one command in, its full reply appended to out
+static void batch_answer(char *line, Reply *out) {
+    compact_poll();
+    const char *why = batch_exec(line, out);
+    if (why) reply_error(out, why);
+}
+
+// commands from in, replies to out; blank lines and # comments are skipped
+static int batch_run(FILE *in, FILE *out) {
+    char line[1024];
+    Reply r = { NULL, 0, 0, 0 };
+    int ok = 1;
+    while (ok && fgets(line, sizeof line, in)) {
+        size_t len = strlen(line);
+        r.len = 0;
+        if (len == sizeof line - 1 && line[len-1] != '\n') {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+            fprintf(out, "ERR line too long\n");
+            continue;
+        }
+        chomp(line);
+        if (!line[0] || line[0] == '#') continue;
+        batch_answer(line, &r);
+        if (r.failed || fwrite(r.buf, 1, r.len, out) != r.len) ok = 0;
+    }
+    free(r.buf);
+    return fflush(out) == 0 && ok;
+}
+
+
+/* Daemon mode: the store stays resident and answers batch commands over a Unix socket.
+   Requests and replies are framed as a 4-byte big-endian length and that many bytes. */
+
+#define SERVE_MAX_FRAME   4096          // a request is one command line
+#define SERVE_MAX_PENDING (1 << 20)     // stop reading a client this far behind on replies
+#define SERVE_READ_CHUNK  (64 * 1024)   // a pipelined burst usually arrives in one read
+#define SERVE_EVENTS      64
+#define SERVE_MAX_THREADS 16
+#define SERVE_SYNC_MS     100           // how stale reads may get behind other processes' writes
+#define SERVE_WRITE_RUN   64            // pipelined writes sharing one append, sync and publish
+
+#ifdef __linux__
+static size_t serve_threads;            // event loops, main thread included; 0 = online CPUs
+
+/* Read views: GET and FIND run against an immutable copy of the table while one
+   writer at a time changes the store and then publishes a new copy with a single
+   pointer swap. Consecutive views share every chunk and every page of the OrderID
+   index that did not change. A view retired at epoch e is freed once every reader
+   inside a view entered after e. */
+
+#define VIEW_ID_PAGE 64     // OrderIDs per page of a view's ID index, on average
+
+typedef struct {
+    size_t n;                   // rows used
+    uint64_t dead[VIEW_CHUNK / 64];     // deleted rows; raw lines count as deleted
+    uint64_t fresh[VIEW_CHUNK / 64];    // names set after trigram base gram_gen was built
+    unsigned long gram_gen;
+    Order rows[VIEW_CHUNK];
+    char product_lc[VIEW_CHUNK][sizeof ((Order *)0)->product];  // zeroed for deleted rows
+    char (*date_text)[20];      // own copies of date texts (rows with date 0); made on first need
+} ViewChunk;
+
+typedef struct {
+    int id;
+    size_t pos;
+} ViewIdEntry;
+
+// the live rows whose OrderID hashes here, sorted by (OrderID, position)
+typedef struct {
+    size_t n, cap;
+    ViewIdEntry e[];
+} ViewIdPage;
+
+typedef struct View {
+    ViewChunk **chunks;
+    size_t nchunks, len;
+    ViewIdPage **pages;         // OrderID -> positions; a power of two of them
+    size_t npages;
+    GramIndex *grams;           // trigram base: the names as of generation gram_gen, shared until rebuilt
+    unsigned long gram_gen;
+    size_t gram_rows;           // rows when it was built
+    uint64_t *gram_dirty;       // one bit per chunk holding fresh rows
+    size_t nfresh;
+    void **dead;                // chunks (and their texts) and pages replaced by the next view; freed along with this one
+    size_t ndead;
+    GramIndex *grams_dead;      // trigram base replaced by the next view
+    unsigned long retired;      // epoch when the next view went up
+    struct View *next;          // retired list
+} View;
+
+static size_t view_gram_slack = 4096;   // fresh rows a trigram base takes before a rebuild, on top of 1/8 of its rows
+static View *view_current;              // swapped atomically; readers only load it
+static View *view_retired;              // writer only
+static unsigned long view_epoch = 1;
+static struct {
+    unsigned long epoch;                // 0 outside a read
+    char pad[64 - sizeof(unsigned long)];
+} view_readers[SERVE_MAX_THREADS];
+static pthread_mutex_t view_writer = PTHREAD_MUTEX_INITIALIZER;
+
+static int view_live(const ViewChunk *vc, size_t i) {
+    return i < vc->n && !(vc->dead[i / 64] >> (i % 64) & 1);
+}
+
+// bring row i of the chunk at base in line with the store; 0 if out of memory
+static int view_chunk_set(ViewChunk *vc, size_t base, size_t i) {
+    Order *o = &vc->rows[i];
+    uint64_t mask = (uint64_t)1 << (i % 64);
+    if (i >= vc->n) vc->n = i + 1;
+    *o = store.rows[base + i];
+    if (row_is_line(o) || store_dead(base + i)) {
+        o->raw = NULL;
+        vc->dead[i / 64] |= mask;
+        memset(vc->product_lc[i], 0, sizeof vc->product_lc[i]);
+        return 1;
+    }
+    if (o->raw) {   // the store's text may be freed while this view is still read
+        if (!vc->date_text && !(vc->date_text = malloc(VIEW_CHUNK * sizeof *vc->date_text))) {
+            perror("view");
+            o->raw = NULL;
+            vc->dead[i / 64] |= mask;
+            return 0;
+        }
+        snprintf(vc->date_text[i], sizeof vc->date_text[i], "%s", o->raw);
+        o->raw = vc->date_text[i];
+    }
+    vc->dead[i / 64] &= ~mask;
+    product_fold(o->product, vc->product_lc[i], sizeof vc->product_lc[i]);
+    return 1;
+}
+
+static void view_chunk_free(ViewChunk *vc) {
+    if (vc) free(vc->date_text);
+    free(vc);
+}
+
+// a private copy of a chunk the old view shares, to patch
+static ViewChunk *view_chunk_clone(const ViewChunk *old) {
+    ViewChunk *vc = malloc(sizeof *vc);
+    if (!vc) { perror("view"); return NULL; }
+    memcpy(vc, old, sizeof *vc);
+    if (!old->date_text) return vc;
+    if (!(vc->date_text = malloc(VIEW_CHUNK * sizeof *vc->date_text))) { perror("view"); free(vc); return NULL; }
+    memcpy(vc->date_text, old->date_text, VIEW_CHUNK * sizeof *vc->date_text);
+    for (size_t i = 0; i < vc->n; ++i)
+        if (vc->rows[i].raw) vc->rows[i].raw = vc->date_text[i];
+    return vc;
+}
+
+// copy chunk c out of the store
+static ViewChunk *view_chunk_build(size_t c) {
+    ViewChunk *vc = malloc(sizeof *vc);
+    if (!vc) { perror("view"); return NULL; }
+    size_t base = c * VIEW_CHUNK, n = store.len - base < VIEW_CHUNK ? store.len - base : VIEW_CHUNK;
+    vc->n = 0;
+    vc->date_text = NULL;
+    vc->gram_gen = 0;
+    memset(vc->dead, 0, sizeof vc->dead);
+    memset(vc->fresh, 0, sizeof vc->fresh);
+    for (size_t i = 0; i < n; ++i)
+        if (!view_chunk_set(vc, base, i)) { view_chunk_free(vc); return NULL; }
+    return vc;
+}
+
+static ViewIdPage *view_page_alloc(size_t cap) {
+    ViewIdPage *pg = malloc(sizeof *pg + cap * sizeof pg->e[0]);
+    if (!pg) { perror("view"); return NULL; }
+    pg->n = 0;
+    pg->cap = cap;
+    return pg;
+}
+
+// first entry at or after (id, pos)
+static size_t view_page_lower(const ViewIdPage *pg, int id, size_t pos) {
+    size_t lo = 0, hi = pg->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const ViewIdEntry *e = &pg->e[mid];
+        if (e->id < id || (e->id == id && e->pos < pos)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int cmp_view_entry(const void *a, const void *b) {
+    const ViewIdEntry *x = a, *y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+// smallest power of two keeping pages at VIEW_ID_PAGE entries or fewer on average
+static size_t view_page_count(size_t rows) {
+    size_t n = 1;
+    while (n * VIEW_ID_PAGE < rows) n *= 2;
+    return n;
+}
+
+// every live row of the chunks into npages new pages
+static int view_ids_build(ViewIdPage **pages, size_t npages, ViewChunk *const *chunks, size_t nchunks) {
+    size_t *count = calloc(npages, sizeof *count);
+    if (!count) { perror("view"); return 0; }
+    for (size_t c = 0; c < nchunks; ++c)
+        for (size_t i = 0; i < chunks[c]->n; ++i)
+            if (view_live(chunks[c], i)) count[id_hash(chunks[c]->rows[i].orderid, npages)]++;
+    int ok = 1;
+    for (size_t p = 0; ok && p < npages; ++p) ok = (pages[p] = view_page_alloc(count[p] + count[p] / 2 + 4)) != NULL;
+    free(count);
+    if (!ok) return 0;
+    for (size_t c = 0; c < nchunks; ++c)
+        for (size_t i = 0; i < chunks[c]->n; ++i) {
+            if (!view_live(chunks[c], i)) continue;
+            int id = chunks[c]->rows[i].orderid;
+            ViewIdPage *pg = pages[id_hash(id, npages)];
+            pg->e[pg->n].id = id;
+            pg->e[pg->n++].pos = c * VIEW_CHUNK + i;
+        }
+    for (size_t p = 0; p < npages; ++p) qsort(pages[p]->e, pages[p]->n, sizeof pages[p]->e[0], cmp_view_entry);
+    return 1;
+}
+
+// add or drop (id, pos) in the pages being published: a page still shared with
+// the old view (shared[p]) is copied on its first change, one of ours grows in place
+static int view_ids_edit(ViewIdPage **pages, ViewIdPage *const *shared, size_t npages, int id, size_t pos, int add) {
+    size_t p = id_hash(id, npages);
+    ViewIdPage *pg = pages[p];
+    size_t at = view_page_lower(pg, id, pos);
+    int has = at < pg->n && pg->e[at].id == id && pg->e[at].pos == pos;
+    if (has == add) return 1;
+    int mine = !shared || pg != shared[p];
+    if (!mine || (add && pg->n == pg->cap)) {
+        ViewIdPage *np = view_page_alloc(pg->n < pg->cap ? pg->cap : pg->cap * 2);
+        if (!np) return 0;
+        np->n = pg->n;
+        memcpy(np->e, pg->e, pg->n * sizeof pg->e[0]);
+        if (mine) free(pg);
+        pages[p] = pg = np;
+    }
+    if (add) {
+        memmove(&pg->e[at + 1], &pg->e[at], (pg->n - at) * sizeof pg->e[0]);
+        pg->e[at].id = id;
+        pg->e[at].pos = pos;
+        pg->n++;
+    } else {
+        memmove(&pg->e[at], &pg->e[at + 1], (pg->n - at - 1) * sizeof pg->e[0]);
+        pg->n--;
+    }
+    return 1;
+}
+
+static void view_grams_free(GramIndex *gx) {
+    if (gx) gram_index_free(gx);
+    free(gx);
+}
+
+// trigram base over the live rows of the chunks; NULL without memory (FIND then scans)
+static GramIndex *view_grams_build(ViewChunk *const *chunks, size_t nchunks) {
+    GramIndex *gx = calloc(1, sizeof *gx);
+    if (!gx) { perror("view"); return NULL; }
+    if (nchunks * VIEW_CHUNK > UINT32_MAX) { free(gx); return NULL; }
+    for (size_t c = 0; c < nchunks; ++c)
+        for (size_t i = 0; i < chunks[c]->n; ++i)
+            if (view_live(chunks[c], i) && !gram_index_add(gx, chunks[c]->product_lc[i], c * VIEW_CHUNK + i)) {
+                view_grams_free(gx);
+                return NULL;
+            }
+    gx->built = 1;
+    return gx;
+}
+
+// row i of chunk c got a name the view's trigram base does not know
+static void view_mark_fresh(View *v, ViewChunk *vc, size_t c, size_t i) {
+    if (vc->gram_gen != v->gram_gen) {
+        memset(vc->fresh, 0, sizeof vc->fresh);
+        vc->gram_gen = v->gram_gen;
+    }
+    uint64_t mask = (uint64_t)1 << (i % 64);
+    if (vc->fresh[i / 64] & mask) return;
+    vc->fresh[i / 64] |= mask;
+    v->gram_dirty[c / 64] |= (uint64_t)1 << (c % 64);
+    v->nfresh++;
+}
+
+// free a retired view with the blocks only it held; all = also the ones it shares (shutdown)
+static void view_free(View *v, int all) {
+    for (size_t i = 0; i < v->ndead; ++i) free(v->dead[i]);
+    if (all) for (size_t i = 0; i < v->nchunks; ++i) view_chunk_free(v->chunks[i]);
+    if (all) for (size_t i = 0; i < v->npages; ++i) free(v->pages[i]);
+    if (all) view_grams_free(v->grams);
+    view_grams_free(v->grams_dead);
+    free(v->gram_dirty);
+    free(v->dead);
+    free(v->chunks);
+    free(v->pages);
+    free(v);
+}
+
+// writer only: free retired views no reader can still be in
+static void view_reclaim(void) {
+    unsigned long oldest = ULONG_MAX;
+    for (size_t i = 0; i < SERVE_MAX_THREADS; ++i) {
+        unsigned long e = __atomic_load_n(&view_readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (e && e < oldest) oldest = e;
+    }
+    for (View **pp = &view_retired; *pp; ) {
+        View *v = *pp;
+        if (v->retired < oldest) { *pp = v->next; view_free(v, 0); }
+        else pp = &v->next;
+    }
+}
+
+// writer only: make the store as it is now what readers see. On failure the
+// old view stays up and the changes are picked up by the next publish
+static int view_publish(void) {
+    View *old = view_current;
+    int fresh = !old || store.retouch;
+    if (!find_impl) find_impl = find_pick();    // before any reader runs view_find
+    if (!fresh && !store.ntouched && old->len == store.len) return 1;
+
+    size_t nchunks = (store.len + VIEW_CHUNK - 1) / VIEW_CHUNK;
+    size_t keep = fresh ? 0 : old->nchunks < nchunks ? old->nchunks : nchunks;
+    size_t npages = view_page_count(store.len);
+    int rebuild = fresh || npages > old->npages;    // grown: every ID moves to a new page
+    if (!rebuild) npages = old->npages;
+    ViewIdPage *const *shared = rebuild ? NULL : old->pages;
+    int regram = fresh || !old->grams;
+    size_t ndirty = (nchunks + 63) / 64;
+    View *v = calloc(1, sizeof *v);
+    ViewChunk **chunks = calloc(nchunks ? nchunks : 1, sizeof *chunks);
+    ViewIdPage **pages = calloc(npages, sizeof *pages);
+    uint64_t *dirty = calloc(ndirty ? ndirty : 1, sizeof *dirty);
+    void **dead = old ? calloc(2 * old->nchunks + old->npages, sizeof *dead) : NULL;
+    if (!v || !chunks || !pages || !dirty || (old && !dead)) {
+        perror("view");
+        free(v); free(chunks); free(pages); free(dirty); free(dead);
+        return 0;
+    }
+    if (keep) memcpy(chunks, old->chunks, keep * sizeof *chunks);
+    if (!rebuild) memcpy(pages, old->pages, npages * sizeof *pages);
+    v->gram_dirty = dirty;
+    if (!regram) {
+        size_t had = (old->nchunks + 63) / 64;
+        memcpy(dirty, old->gram_dirty, (had < ndirty ? had : ndirty) * sizeof *dirty);
+        v->grams = old->grams;
+        v->gram_gen = old->gram_gen;
+        v->gram_rows = old->gram_rows;
+        v->nfresh = old->nfresh;
+    }
+
+    // new chunks are built whole; an old one is cloned on its first write and
+    // patched, and so is each ID page a patched row leaves or joins. Rows whose
+    // names the trigram base does not have yet are marked fresh
+    int ok = 1;
+    for (size_t c = keep; ok && c < nchunks; ++c) ok = (chunks[c] = view_chunk_build(c)) != NULL;
+    for (size_t c = keep; ok && !regram && c < nchunks; ++c)
+        for (size_t i = 0; i < chunks[c]->n; ++i)
+            if (view_live(chunks[c], i)) view_mark_fresh(v, chunks[c], c, i);
+    for (size_t t = 0; ok && !fresh && t < store.ntouched; ++t) {
+        size_t pos = store.touched[t], c = pos / VIEW_CHUNK, i = pos % VIEW_CHUNK;
+        if (c >= keep || pos >= store.len) continue;
+        if (chunks[c] == old->chunks[c] && !(chunks[c] = view_chunk_clone(old->chunks[c]))) {
+            chunks[c] = old->chunks[c];
+            ok = 0;
+            break;
+        }
+        ViewChunk *vc = chunks[c];
+        int was = view_live(vc, i), id = vc->rows[i].orderid;
+        char lc[sizeof vc->product_lc[i]];
+        memcpy(lc, vc->product_lc[i], sizeof lc);
+        if (!(ok = view_chunk_set(vc, c * VIEW_CHUNK, i))) break;
+        int now = view_live(vc, i);
+        if (!regram && now && (!was || strcmp(lc, vc->product_lc[i]) != 0)) view_mark_fresh(v, vc, c, i);
+        if (rebuild || (was == now && (!now || id == vc->rows[i].orderid))) continue;
+        if (was) ok = view_ids_edit(pages, shared, npages, id, pos, 0);
+        if (ok && now) ok = view_ids_edit(pages, shared, npages, vc->rows[i].orderid, pos, 1);
+    }
+    if (rebuild) ok = ok && view_ids_build(pages, npages, chunks, nchunks);
+    for (size_t c = keep; ok && !rebuild && c < nchunks; ++c)
+        for (size_t i = 0; ok && i < chunks[c]->n; ++i)
+            if (view_live(chunks[c], i))
+                ok = view_ids_edit(pages, shared, npages, chunks[c]->rows[i].orderid, c * VIEW_CHUNK + i, 1);
+    if (!ok) {
+        for (size_t c = 0; c < nchunks; ++c)
+            if (chunks[c] && (c >= keep || chunks[c] != old->chunks[c])) view_chunk_free(chunks[c]);
+        for (size_t p = 0; p < npages; ++p)
+            if (!shared || pages[p] != shared[p]) free(pages[p]);
+        free(v); free(chunks); free(pages); free(dirty); free(dead);
+        return 0;
+    }
+
+    // too many fresh rows make FIND check them all: start a new base. Without
+    // memory for it FIND scans every name until a later publish manages one
+    regram = regram || v->nfresh > view_gram_slack + v->gram_rows / 8;
+    if (regram) {
+        memset(dirty, 0, (ndirty ? ndirty : 1) * sizeof *dirty);
+        v->grams = view_grams_build(chunks, nchunks);
+        v->gram_gen = old ? old->gram_gen + 1 : 1;
+        v->gram_rows = store.len;
+        v->nfresh = 0;
+    }
+
+    v->chunks = chunks;
+    v->nchunks = nchunks;
+    v->pages = pages;
+    v->npages = npages;
+    v->len = store.len;
+    __atomic_store_n(&view_current, v, __ATOMIC_SEQ_CST);
+    store.ntouched = 0;
+    store.retouch = 0;
+    if (old) {
+        for (size_t c = 0; c < old->nchunks; ++c)
+            if (c >= keep || chunks[c] != old->chunks[c]) {
+                dead[old->ndead++] = old->chunks[c];
+                if (old->chunks[c]->date_text) dead[old->ndead++] = old->chunks[c]->date_text;
+            }
+        for (size_t p = 0; p < old->npages; ++p)
+            if (rebuild || pages[p] != old->pages[p]) dead[old->ndead++] = old->pages[p];
+        if (regram) old->grams_dead = old->grams;
+        old->dead = dead;
+        old->retired = __atomic_fetch_add(&view_epoch, 1, __ATOMIC_SEQ_CST);
+        old->next = view_retired;
+        view_retired = old;
+    }
+    view_reclaim();
+    return 1;
+}
+
+// once no reader is left: free every view and stop tracking changes
+static void view_drop(void) {
+    view_reclaim();
+    if (view_current) view_free(view_current, 1);
+    view_current = NULL;
+    store.tracking = 0;
+    store.retouch = 0;
+    store.ntouched = 0;
+}
+
+static const View *view_enter(size_t slot) {
+    __atomic_store_n(&view_readers[slot].epoch, __atomic_load_n(&view_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&view_current, __ATOMIC_SEQ_CST);
+}
+
+static void view_exit(size_t slot) {
+    __atomic_store_n(&view_readers[slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    const Order **rows;
+    size_t len, cap;
+} ViewHits;
+
+static void view_hit(ViewHits *h, const Order *o) {
+    if (grow_array((void **)&h->rows, &h->cap, h->len + 1, sizeof *h->rows)) h->rows[h->len++] = o;
+}
+
+// one page of the ID index holds every row with this OrderID, in file order
+static void view_get(const View *v, int id, ViewHits *h) {
+    const ViewIdPage *pg = v->pages[id_hash(id, v->npages)];
+    for (size_t k = view_page_lower(pg, id, 0); k < pg->n && pg->e[k].id == id; ++k) {
+        size_t pos = pg->e[k].pos;
+        view_hit(h, &v->chunks[pos / VIEW_CHUNK]->rows[pos % VIEW_CHUNK]);
+    }
+}
+
+// the folded names of a chunk are one fixed-width block, scanned like the fold column
+static void view_scan(const View *v, const char *needle_lc, ViewHits *h) {
+    size_t m = strlen(needle_lc), w = sizeof v->chunks[0]->product_lc[0];
+    for (size_t c = 0; c < v->nchunks; ++c) {
+        const ViewChunk *vc = v->chunks[c];
+        const char *base = vc->product_lc[0], *p = base, *end = base + vc->n * w;
+        STAT_COUNT(CT_ROWS_SCANNED, vc->n);
+        while ((p = find_impl(p, (size_t)(end - p), needle_lc, m)) != NULL) {
+            size_t i = (size_t)(p - base) / w;
+            if (!(vc->dead[i / 64] >> (i % 64) & 1)) view_hit(h, &vc->rows[i]);
+            p = base + (i + 1) * w;     // one hit per name
+        }
+    }
+}
+
+static void view_check(const ViewChunk *vc, size_t i, const char *needle_lc, ViewHits *h) {
+    if (view_live(vc, i) && strstr(vc->product_lc[i], needle_lc)) view_hit(h, &vc->rows[i]);
+}
+
+// the trigram base shortlists rows by their names when it was built; rows named
+// since are fresh in their chunks and checked too. Both in file order, merged
+static void view_find(const View *v, const char *needle_lc, ViewHits *h) {
+    uint32_t *cand;
+    size_t n = v->grams ? gram_intersect(v->grams, needle_lc, &cand) : (size_t)-1, k = 0;
+    if (n == (size_t)-1) { view_scan(v, needle_lc, h); return; }
+    STAT_COUNT(CT_ROWS_SCANNED, n + v->nfresh);
+    for (size_t w = 0; w < (v->nchunks + 63) / 64; ++w) {
+        if (!v->gram_dirty[w]) continue;
+        for (size_t c = w * 64; c < v->nchunks && c < (w + 1) * 64; ++c) {
+            if (!(v->gram_dirty[w] >> (c % 64) & 1)) continue;
+            const ViewChunk *vc = v->chunks[c];
+            size_t base = c * VIEW_CHUNK;
+            for (; k < n && cand[k] < base; ++k) view_check(v->chunks[cand[k] / VIEW_CHUNK], cand[k] % VIEW_CHUNK, needle_lc, h);
+            for (size_t i = 0; i < vc->n; ++i) {
+                int listed = k < n && cand[k] == base + i;
+                k += listed;
+                if (listed || (vc->fresh[i / 64] >> (i % 64) & 1)) view_check(vc, i, needle_lc, h);
+            }
+        }
+    }
+    for (; k < n; ++k) view_check(v->chunks[cand[k] / VIEW_CHUNK], cand[k] % VIEW_CHUNK, needle_lc, h);
+    free(cand);
+}
+
+// GET and FIND straight from the current view; 0 for commands that need the writer
+static int view_answer(size_t slot, char *line, Reply *out) {
+    char *arg = strchr(line, ' ');
+    size_t len = arg ? (size_t)(arg - line) : strlen(line);
+    int get = len == 3 && strncmp(line, "GET", 3) == 0;
+    int find = len == 4 && strncmp(line, "FIND", 4) == 0;
+    if (!get && !find) return 0;
+    arg = arg ? arg + 1 : line + len;
+
+    int id = 0;
+    char needle_lc[64];
+    if (get && !try_parse_int(arg, &id)) { reply_error(out, "bad order id"); return 1; }
+    if (find && !arg[0]) { reply_error(out, "empty search"); return 1; }
+    if (find) product_fold(arg, needle_lc, sizeof needle_lc);
+
+    ViewHits h = { NULL, 0, 0 };
+    STAT_START(t0);
+    TRACE_BEGIN(tr);
+    const View *v = view_enter(slot);
+    if (get) view_get(v, id, &h);
+    else view_find(v, needle_lc, &h);
+    TRACE_END(tr, "match");
+    STAT_STOP(get ? OP_GET : OP_FIND, t0);
+    STAT_COUNT(CT_ROWS_MATCHED, h.len);
+
+    char buf[256];
+    reply_put(out, buf, (size_t)snprintf(buf, sizeof buf, "OK %lu\n", (unsigned long)h.len));
+    for (size_t i = 0; i < h.len; ++i) reply_put(out, buf, (size_t)format_order(buf, sizeof buf, h.rows[i]));
+    view_exit(slot);
+    free(h.rows);
+    return 1;
+}
+
+/* Event loops: one per thread, each with its own epoll set and its own clients.
+   The listener sits in every set; whichever loop accepts a client keeps it. */
+
+typedef struct Conn {
+    int fd;
+    char *in;               // bytes received, not yet a whole frame
+    size_t in_len, in_cap;
+    Reply out;              // framed replies not yet sent
+    size_t out_off;
+    uint32_t events;        // what epoll is currently asked for
+    int eof;                // peer is done sending; close once replies are out
+    struct Conn *prev, *next;
+} Conn;
+
+typedef struct {
+    int ep;
+    size_t slot;            // this loop's reader epoch slot
+    Conn *conns;
+    pthread_t tid;
+    int lfd, quit;
+    size_t writes;          // writes in the open write section, which holds view_writer
+} ServeLoop;
+
+static volatile sig_atomic_t serve_stop;
+static int serve_wake[2];   // written once at shutdown; every loop watches the read end
+
+static void serve_on_signal(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+static int set_nonblock(int fd) {
+    int fl = fcntl(fd, F_GETFL);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
+}
+
+static void conn_close(ServeLoop *lp, Conn *c) {
+    epoll_ctl(lp->ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next; else lp->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    free(c->in);
+    free(c->out.buf);
+    free(c);
+}
+
+static int serve_is_write(const char *line) {
+    size_t n = strcspn(line, " ");
+    return (n == 3 && strncmp(line, "ADD", 3) == 0)
+        || (n == 6 && (strncmp(line, "UPDATE", 6) == 0 || strncmp(line, "DELETE", 6) == 0));
+}
+
+// close the open write section: its appends go out, then one publish
+static int serve_write_end(ServeLoop *lp) {
+    if (!lp->writes) return 1;
+    int ok = store_write_end();
+    compact_maybe_start();
+    view_publish();
+    pthread_mutex_unlock(&view_writer);
+    lp->writes = 0;
+    return ok;
+}
+
+// reads never wait for the writer; everything else runs under it and republishes.
+// Writes arriving back to back share one write section, so a pipelined burst
+// costs one append and one sync; its replies leave only after that.
+// 0 if the section failed to reach the files
+static int serve_answer(ServeLoop *lp, char *line, Reply *out) {
+    if (serve_is_write(line)) {
+        if (!lp->writes) {
+            pthread_mutex_lock(&view_writer);
+            if (!store_write_begin()) {
+                batch_answer(line, out);    // reports the failure
+                pthread_mutex_unlock(&view_writer);
+                return 1;
+            }
+        }
+        lp->writes++;
+        batch_answer(line, out);
+        return lp->writes < SERVE_WRITE_RUN || serve_write_end(lp);
+    }
+    // a read after writes must see them
+    if (!serve_write_end(lp)) return 0;
+    if (view_answer(lp->slot, line, out)) return 1;
+    pthread_mutex_lock(&view_writer);
+    batch_answer(line, out);
+    view_publish();
+    pthread_mutex_unlock(&view_writer);
+    return 1;
+}
+
+// answer every whole frame received so far; 0 on a protocol error
+static int conn_answer(ServeLoop *lp, Conn *c) {
+    size_t off = 0;
+    int ok = 1;
+    while (ok && c->in_len - off >= 4 && c->out.len - c->out_off < SERVE_MAX_PENDING) {
+        const unsigned char *h = (const unsigned char *)c->in + off;
+        size_t n = (size_t)h[0] << 24 | (size_t)h[1] << 16 | (size_t)h[2] << 8 | h[3];
+        if (n >= SERVE_MAX_FRAME) { ok = 0; break; }
+        if (c->in_len - off - 4 < n) break;
+        char line[SERVE_MAX_FRAME];
+        memcpy(line, c->in + off + 4, n);
+        line[n] = '\0';
+        off += 4 + n;
+
+        // length goes in front once the reply is known
+        size_t at = c->out.len;
+        reply_put(&c->out, "\0\0\0\0", 4);
+        chomp(line);
+        ok = serve_answer(lp, line, &c->out) && !c->out.failed;
+        size_t len = c->out.len - at - 4;
+        unsigned char *p = (unsigned char *)c->out.buf + at;
+        p[0] = (unsigned char)(len >> 24);
+        p[1] = (unsigned char)(len >> 16);
+        p[2] = (unsigned char)(len >> 8);
+        p[3] = (unsigned char)len;
+    }
+    // replies to writes are only sent once the writes are in the files
+    if (!serve_write_end(lp)) ok = 0;
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+    return ok;
+}
+
+// read and answer everything the client has sent; replies collect in c->out
+// and leave in one send from conn_flush. 0 when the connection should be dropped
+static int conn_read(ServeLoop *lp, Conn *c) {
+    while (!c->eof && c->out.len - c->out_off < SERVE_MAX_PENDING) {
+        if (!grow_array((void **)&c->in, &c->in_cap, c->in_len + SERVE_READ_CHUNK, 1)) return 0;
+        ssize_t n = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0) return 0;
+        if (n == 0) c->eof = 1;
+        c->in_len += (size_t)n;
+        if (!conn_answer(lp, c)) return 0;
+    }
+    return 1;
+}
+
+// send what we can, then ask epoll for whatever is still needed
+static int conn_flush(ServeLoop *lp, Conn *c) {
+    while (c->out_off < c->out.len) {
+        ssize_t n = send(c->fd, c->out.buf + c->out_off, c->out.len - c->out_off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0) return 0;
+        c->out_off += (size_t)n;
+    }
+    if (c->out_off == c->out.len) {
+        c->out.len = c->out_off = 0;
+        if (c->eof) return 0;
+        // replies drained: frames held back by the pending cap can go now
+        if (c->in_len && (!conn_answer(lp, c) || c->out.len)) return c->out.failed ? 0 : conn_flush(lp, c);
+    }
+    int behind = c->out.len - c->out_off >= SERVE_MAX_PENDING;
+    uint32_t want = (c->eof || behind ? 0 : EPOLLIN) | (c->out_off < c->out.len ? EPOLLOUT : 0);
+    if (want != c->events) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof ev);
+        ev.events = want;
+        ev.data.ptr = c;
+        if (epoll_ctl(lp->ep, EPOLL_CTL_MOD, c->fd, &ev) != 0) return 0;
+        c->events = want;
+    }
+    return 1;
+}
+
+static void serve_accept(ServeLoop *lp) {
+    for (;;) {
+        int fd = accept(lp->lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        Conn *c = calloc(1, sizeof *c);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof ev);
+        ev.events = EPOLLIN;
+        ev.data.ptr = c;
+        if (!c || !set_nonblock(fd) || epoll_ctl(lp->ep, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("accept");
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+        c->next = lp->conns;
+        if (lp->conns) lp->conns->prev = c;
+        lp->conns = c;
+    }
+}
+
+// the listener and the wake pipe are tagged by these addresses
+static char serve_listen_tag, serve_wake_tag;
+
+static int serve_loop_open(ServeLoop *lp, int lfd, size_t slot) {
+    memset(lp, 0, sizeof *lp);
+    lp->lfd = lfd;
+    lp->slot = slot;
+    lp->ep = epoll_create1(0);
+    if (lp->ep < 0) return 0;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+#ifdef EPOLLEXCLUSIVE
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;   // wake one loop per new client, not all
+#else
+    ev.events = EPOLLIN;
+#endif
+    ev.data.ptr = &serve_listen_tag;
+    if (epoll_ctl(lp->ep, EPOLL_CTL_ADD, lfd, &ev) != 0) { close(lp->ep); return 0; }
+    ev.events = EPOLLIN;
+    ev.data.ptr = &serve_wake_tag;
+    if (epoll_ctl(lp->ep, EPOLL_CTL_ADD, serve_wake[0], &ev) != 0) { close(lp->ep); return 0; }
+    return 1;
+}
+
+static void serve_loop_close(ServeLoop *lp) {
+    while (lp->conns) conn_close(lp, lp->conns);
+    close(lp->ep);
+}
+
+// the main loop (owner) also installs finished compactions, picks up other
+// processes' writes and frees old views while idle
+static void serve_loop_run(ServeLoop *lp, int owner) {
+    struct epoll_event evs[SERVE_EVENTS];
+    double synced = now_seconds();
+    while (!lp->quit && !(owner && serve_stop)) {
+        int n = epoll_wait(lp->ep, evs, SERVE_EVENTS, owner ? SERVE_SYNC_MS : -1);
+        if (n < 0 && errno != EINTR) { perror("epoll_wait"); break; }
+        for (int i = 0; i < n; ++i) {
+            void *tag = evs[i].data.ptr;
+            if (tag == &serve_listen_tag) { serve_accept(lp); continue; }
+            if (tag == &serve_wake_tag) { lp->quit = 1; continue; }
+            Conn *c = tag;
+            if (!conn_read(lp, c) || !conn_flush(lp, c)) conn_close(lp, c);
+        }
+        if (owner) {
+            pthread_mutex_lock(&view_writer);
+            compact_poll();
+            if (now_seconds() - synced >= SERVE_SYNC_MS / 1000.0) {
+                store_refresh();
+                synced = now_seconds();
+            }
+            view_publish();
+            view_reclaim();
+            pthread_mutex_unlock(&view_writer);
+        }
+    }
+}
+
+static void *serve_loop_main(void *arg) {
+    serve_loop_run(arg, 0);
+    return NULL;
+}
+
+// run until SIGINT/SIGTERM
+static int serve(const char *path) {
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof sa.sun_path) { fprintf(stderr, "%s: socket path too long\n", path); return 0; }
+    strcpy(sa.sun_path, path);
+
+    // a socket file nobody answers on is left over from an earlier run
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&sa, sizeof sa) == 0) {
+        fprintf(stderr, "%s: another daemon is serving here\n", path);
+        close(probe);
+        return 0;
+    }
+    if (probe >= 0) close(probe);
+    unlink(path);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&sa, sizeof sa) != 0 ||
+        listen(lfd, SOMAXCONN) != 0 || !set_nonblock(lfd)) {
+        perror(path);
+        if (lfd >= 0) close(lfd);
+        return 0;
+    }
+
+    size_t nloops = serve_threads ? serve_threads : scan_width();
+    if (nloops > SERVE_MAX_THREADS) nloops = SERVE_MAX_THREADS;
+    ServeLoop loops[SERVE_MAX_THREADS];
+    if (pipe(serve_wake) != 0) {
+        perror("serve");
+        close(lfd);
+        unlink(path);
+        return 0;
+    }
+    store.tracking = 1;
+    if (!view_publish() || !serve_loop_open(&loops[0], lfd, 0)) {
+        perror("serve");
+        close(serve_wake[0]);
+        close(serve_wake[1]);
+        close(lfd);
+        unlink(path);
+        view_drop();
+        return 0;
+    }
+
+    struct sigaction sig;
+    memset(&sig, 0, sizeof sig);
+    sig.sa_handler = serve_on_signal;
+    sigemptyset(&sig.sa_mask);
+    sigaction(SIGINT, &sig, NULL);
+    sigaction(SIGTERM, &sig, NULL);
+
+    // the other loops never see the signals, so the main loop's epoll_wait is the one interrupted
+    sigset_t block, prev;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &prev);
+    size_t started = 1;
+    while (started < nloops && serve_loop_open(&loops[started], lfd, started)) {
+        if (pthread_create(&loops[started].tid, NULL, serve_loop_main, &loops[started]) != 0) {
+            serve_loop_close(&loops[started]);
+            break;
+        }
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &prev, NULL);
+
+    printf("Serving %s on %s with %lu thread(s)\n", CSV_FILE, path, (unsigned long)started);
+    fflush(stdout);
+
+    serve_loop_run(&loops[0], 1);
+
+    if (write(serve_wake[1], "x", 1) != 1) perror("serve");
+    for (size_t i = 1; i < started; ++i) {
+        pthread_join(loops[i].tid, NULL);
+        serve_loop_close(&loops[i]);
+    }
+    serve_loop_close(&loops[0]);
+    close(serve_wake[0]);
+    close(serve_wake[1]);
+    close(lfd);
+    unlink(path);
+
+    view_drop();
+    serve_stop = 0;
+    printf("Daemon stopped.\n");
+    return 1;
+}
+#else
+static int serve(const char *path) {
+    fprintf(stderr, "%s: daemon mode needs Linux (epoll)\n", path);
+    return 0;
+}
+#endif
+
+
+/*  Menu  */
+
+static int read_menu_choice(int minc, int maxc) {
+    char buf[64];
+    int c;
+    for (;;) {
+        read_line("Choose: ", buf, sizeof buf);
+        if (try_parse_int(buf, &c) && c >= minc && c <= maxc) return c;
+        printf("Please enter a number between %d and %d.\n", minc, maxc);
+    }
+}
+
+static void searchMenu(void) {
+    for (;;) {
+        printf("\n-- Search Menu --\n");
+        printf("[1] By Order ID\n");
+        printf("[2] By Product Name\n");
+        printf("[3] Back\n");
+        printf("[4] By Date Range\n");
+        int choice = read_menu_choice(1, 4);
+        if (choice == 1)      searchByOrderID();
+        else if (choice == 2) searchByProductName();
+        else if (choice == 4) searchByDateRange();
+        else break;
+    }
+}
+
+//main
+#ifndef UNIT_TESTING
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--durability none|op|group[,OPS[,MS]]] [--stats-json FILE|-] [--trace FILE|-]"
+           " [--get ORDERID | --checkpoint | --import FILE | --batch [FILE] | --serve [SOCKET]]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    // options that apply to every mode below: how hard appends are pushed
+    // to the disk, and where the per-operation stats and trace spans go on exit
+    while (argc > 2 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--stats-json") == 0) stats_json_path = argv[2];
+        else if (strcmp(argv[1], "--trace") == 0) trace_start(argv[2]);
+        else if (strcmp(argv[1], "--durability") != 0) break;
+        else if (!commit_parse_mode(argv[2])) { print_usage(argv[0]); return 2; }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+    ensure_csv_header();
+
+    // one-off lookup through the sidecar index, no full load
+    if (argc == 3 && strcmp(argv[1], "--get") == 0) {
+        int id;
+        Order o;
+        if (!try_parse_int(argv[2], &id)) { print_usage(argv[0]); return 2; }
+        if (idx_file_lookup(id, &o)) { print_order("Found: ", &o); free(o.raw); return 0; }
+        printf("OrderID %d not found.\n", id);
+        return 1;
+    }
+    // fold the change log into the CSV and exit
+    if (argc == 2 && strcmp(argv[1], "--checkpoint") == 0) {
+        if (!store_load() || !store_checkpoint()) return 1;
+        printf("Checkpoint done.\n");
+        stats_dump();
+        trace_dump();
+        return 0;
+    }
+    // append a batch file in one go
+    if (argc == 3 && strcmp(argv[1], "--import") == 0) {
+        int ok = import_csv(argv[2]);
+        commit_close();
+        stats_dump();
+        trace_dump();
+        return ok ? 0 : 1;
+    }
+    // line commands from stdin or a file against one loaded store
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "--batch") == 0) {
+        FILE *in = argc == 3 ? fopen(argv[2], "r") : stdin;
+        if (!in) { perror(argv[2]); return 1; }
+        int ok = store_load() && batch_run(in, stdout);
+        if (in != stdin) fclose(in);
+        compact_wait();
+        commit_close();
+        stats_dump();
+        trace_dump();
+        store_free();
+        return ok ? 0 : 1;
+    }
+    // keep the store resident and answer over a Unix socket
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "--serve") == 0) {
+        int ok = store_load() && serve(argc == 3 ? argv[2] : SOCK_FILE);
+        compact_wait();
+        commit_close();
+        stats_dump();
+        trace_dump();
+        store_free();
+        return ok ? 0 : 1;
+    }
+    if (argc > 1) { print_usage(argv[0]); return 2; }
+
+    store_load();
+
+    for (;;) {
+        printf("\n==== Orders CSV App (safe input) ====\n");
+        printf("[1] Add order\n");
+        printf("[2] Search\n");
+        printf("[3] Update by ID\n");
+        printf("[4] Delete by ID\n");
+        printf("[5] Exit\n");
+        printf("[6] Stats\n");
+        int choice = read_menu_choice(1, 6);
+
+        switch (choice) {
+            case 1: Addcsv(); break;
+            case 2: searchMenu(); break;
+            case 3: updateOrderByID(); break;
+            case 4: deleteByOrderID(); break;
+            case 5: printf("End of program\n"); compact_wait(); commit_close(); stats_dump(); trace_dump(); store_free(); return 0;
+            case 6: stats_print(stdout); break;
+        }
+    }
+}
 #endif
\ No newline at end of file
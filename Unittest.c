@@ -1,391 +1,1448 @@
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-#include <assert.h>
-#include <limits.h>
-#include <math.h>
-#include <ctype.h>
-#include <errno.h>
-
-#define UNIT_TESTING
-#include "OrderManagerForUnittest.c"   // include implementation so we can hit static helpers
-
-// ------------------- mini harness (prints only on FAIL) -------------------
-static int tests_run = 0, tests_failed = 0;
-
-#define CHECK_TRUE(msg, expr) do { \
-    ++tests_run; \
-    if (!(expr)) { ++tests_failed; \
-        printf("[FAIL] %s (at %s:%d)\n", msg, __FILE__, __LINE__); \
-    } \
-} while (0)
-
-#define CHECK_EQ_INT(msg, exp, got) do { \
-    ++tests_run; \
-    if ((int)(exp) != (int)(got)) { ++tests_failed; \
-        printf("[FAIL] %s: expected %d, got %d (at %s:%d)\n", msg, (int)(exp), (int)(got), __FILE__, __LINE__); \
-    } \
-} while (0)
-
-#define CHECK_EQ_STR(msg, exp, got) do { \
-    ++tests_run; \
-    if (strcmp((exp),(got)) != 0) { ++tests_failed; \
-        printf("[FAIL] %s: expected \"%s\", got \"%s\" (at %s:%d)\n", msg, (exp), (got), __FILE__, __LINE__); \
-    } \
-} while (0)
-
-// ------------------- utilities: files, stdin, mute output -----------------
-static void delete_file_if_exists(const char* path) {
-    FILE* f = fopen(path, "r");
-    if (f) { fclose(f); remove(path); }
-}
-
-static void write_text_file(const char* path, const char* content) {
-    FILE* f = fopen(path, "w");
-    assert(f && "cannot open file for writing");
-    fputs(content, f);
-    fclose(f);
-}
-
-static char* read_whole_file(const char* path) {
-    FILE* f = fopen(path, "rb");
-    if (!f) return NULL;
-    fseek(f, 0, SEEK_END);
-    long n = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char* buf = (char*)malloc(n + 1);
-    fread(buf, 1, n, f);
-    buf[n] = '\0';
-    fclose(f);
-    return buf;
-}
-
-// feed next test input via a temp file
-static void set_stdin_from_string(const char* s) {
-    const char* in = "tmp_stdin.txt";
-    write_text_file(in, s);
-    freopen(in, "r", stdin);
-}
-
-#ifdef _WIN32
-  #define DEV_NULL    "NUL"
-  #define CONSOLE_OUT "CON"
-#else
-  #define DEV_NULL    "/dev/null"
-  #define CONSOLE_OUT "/dev/tty"
-#endif
-
-// Mute/unmute app outputs; keep harness output visible.
-static void mute_outputs_begin(void)  { freopen(DEV_NULL, "w", stdout); freopen(DEV_NULL, "w", stderr); }
-static void mute_outputs_end(void)    { freopen(CONSOLE_OUT, "w", stdout); freopen(CONSOLE_OUT, "w", stderr); }
-
-// Run a statement with app output muted (do NOT wrap CHECK_* inside)
-#define RUN_SILENT(stmt) do { mute_outputs_begin(); stmt; mute_outputs_end(); } while (0)
-
-// ------------------- tests for each function ------------------------------
-
-// chomp
-static void t_chomp(void) {
-    char a[32]="hi\n", b[32]="x\r\n", c[32]="nope";
-    chomp(a); chomp(b); chomp(c);
-    CHECK_EQ_STR("chomp \\n", "hi", a);
-    CHECK_EQ_STR("chomp \\r\\n", "x", b);
-    CHECK_EQ_STR("chomp none", "nope", c);
-}
-
-// sanitize_commas
-static void t_sanitize_commas(void) {
-    char s[32] = "a,b,,c";
-    sanitize_commas(s);
-    CHECK_EQ_STR("commas->spaces", "a b  c", s);
-}
-
-// lowercase
-static void t_lowercase(void) {
-    char s[32] = "HeLLo-123";
-    lowercase(s);
-    CHECK_EQ_STR("lowercase", "hello-123", s);
-}
-
-// line_starts_with_digit
-static void t_line_starts_with_digit(void) {
-    CHECK_TRUE("digit", line_starts_with_digit("1,abc"));
-    CHECK_TRUE("spaces+digit", line_starts_with_digit("   9,x"));
-    CHECK_TRUE("no", !line_starts_with_digit("id,1"));
-    CHECK_TRUE("empty", !line_starts_with_digit(""));
-}
-
-// parse_csv_line
-static void t_parse_csv_line(void) {
-    const char* line = "42,John Doe,Widget X,5,12.34,01-01-2024";
-    int id,qty; float price; char customer[50],product[50],date[20];
-    int ok = parse_csv_line(line, &id, customer, product, &qty, &price, date);
-    CHECK_TRUE("parse ok", ok==1);
-    CHECK_EQ_INT("id", 42, id);
-    CHECK_EQ_INT("qty", 5, qty);
-    CHECK_TRUE("price", fabsf(price-12.34f) < 1e-5f);
-    CHECK_EQ_STR("customer", "John Doe", customer);
-    CHECK_EQ_STR("product",  "Widget X", product);
-    CHECK_EQ_STR("date",     "01-01-2024", date);
-
-    const char* bad = "x,y,z";
-    ok = parse_csv_line(bad, &id, customer, product, &qty, &price, date);
-    CHECK_TRUE("parse bad -> 0", ok==0);
-}
-
-// is_valid_date_str
-static void t_is_valid_date_str(void) {
-    CHECK_TRUE("ok",  is_valid_date_str("15-08-2024"));
-    CHECK_TRUE("leap",is_valid_date_str("29-02-2024"));
-    CHECK_TRUE("no 29-02 in 2023", !is_valid_date_str("29-02-2023"));
-    CHECK_TRUE("bad month", !is_valid_date_str("01-13-2024"));
-    CHECK_TRUE("bad day",   !is_valid_date_str("32-01-2024"));
-    CHECK_TRUE("format",    !is_valid_date_str("2024-01-01"));
-}
-
-// read_line (smoke)
-static void t_read_line(void) {
-    char buf[64];
-    set_stdin_from_string("hello world\n");
-    RUN_SILENT(read_line("prompt: ", buf, sizeof buf));
-    CHECK_EQ_STR("read_line", "hello world", buf);
-}
-
-// try_parse_int
-static void t_try_parse_int(void) {
-    int v;
-    CHECK_TRUE("int", try_parse_int("123", &v) && v==123);
-    CHECK_TRUE("neg", try_parse_int("-7", &v)  && v==-7);
-    CHECK_TRUE("bad", !try_parse_int("1x", &v));
-    CHECK_TRUE("empty", !try_parse_int("", &v));
-    // overflow guard
-    char big[64];
-    long long too_big = (long long)INT_MAX + 1LL;
-    snprintf(big, sizeof big, "%lld", too_big);
-    CHECK_TRUE("overflow rejected", !try_parse_int(big, &v));
-}
-
-// try_parse_float
-static void t_try_parse_float(void) {
-    float f;
-    CHECK_TRUE("ok", try_parse_float("3.14", &f) && fabsf(f-3.14f)<1e-5f);
-    CHECK_TRUE("neg", try_parse_float("-2.5", &f) && fabsf(f+2.5f)<1e-5f);
-    CHECK_TRUE("bad", !try_parse_float("1.2.3", &f));
-    CHECK_TRUE("empty", !try_parse_float("", &f));
-}
-
-// read_int_loop (invalid then valid)
-static void t_read_int_loop(void) {
-    int v, rc;
-    set_stdin_from_string("abc\n5\n");
-    RUN_SILENT(rc = read_int_loop("int:", &v, 0, 0));
-    CHECK_TRUE("read_int_loop", rc==1 && v==5);
-}
-
-// read_float_loop (invalid then valid)
-static void t_read_float_loop(void) {
-    float v; int rc;
-    set_stdin_from_string("x\n2.50\n");
-    RUN_SILENT(rc = read_float_loop("flt:", &v, 1, 0.0f));
-    CHECK_TRUE("read_float_loop", rc==1 && fabsf(v-2.5f)<1e-5f);
-}
-
-// read_text_loop (commas sanitized)
-static void t_read_text_loop(void) {
-    char out[32];
-    set_stdin_from_string("A,b,c\n");
-    RUN_SILENT(read_text_loop("txt:", out, sizeof out));
-    CHECK_EQ_STR("sanitized", "A b c", out);
-}
-
-// read_optional_int
-static void t_read_optional_int(void) {
-    int out=99; int rc;
-    set_stdin_from_string("\n");           // blank -> keep
-    RUN_SILENT(rc = read_optional_int("opt-int:", &out));
-    CHECK_TRUE("blank -> 0", rc==0 && out==99);
-
-    set_stdin_from_string("123\n");
-    RUN_SILENT(rc = read_optional_int("opt-int:", &out));
-    CHECK_TRUE("set 123", rc==1 && out==123);
-}
-
-// read_optional_float
-static void t_read_optional_float(void) {
-    float out=1.0f; int rc;
-    set_stdin_from_string("\n");
-    RUN_SILENT(rc = read_optional_float("opt-f:", &out));
-    CHECK_TRUE("blank -> 0", rc==0 && fabsf(out-1.0f)<1e-5f);
-
-    set_stdin_from_string("4.75\n");
-    RUN_SILENT(rc = read_optional_float("opt-f:", &out));
-    CHECK_TRUE("set 4.75", rc==1 && fabsf(out-4.75f)<1e-5f);
-}
-
-// read_optional_text
-static void t_read_optional_text(void) {
-    char out[32]="keep"; int rc;
-    set_stdin_from_string("\n");
-    RUN_SILENT(rc = read_optional_text("opt-t:", out, sizeof out));
-    CHECK_TRUE("blank -> 0", rc==0 && strcmp(out,"keep")==0);
-
-    set_stdin_from_string("x,y\n");
-    RUN_SILENT(rc = read_optional_text("opt-t:", out, sizeof out));
-    CHECK_TRUE("set", rc==1 && strcmp(out,"x y")==0);
-}
-
-// read_date_loop (invalid then valid)
-static void t_read_date_loop(void) {
-    char out[32];
-    set_stdin_from_string("2024-01-01\n01-01-2024\n");
-    RUN_SILENT(read_date_loop("date:", out, sizeof out));
-    CHECK_EQ_STR("date ok", "01-01-2024", out);
-}
-
-// read_optional_date
-static void t_read_optional_date(void) {
-    char out[32]="keep"; int rc;
-    set_stdin_from_string("\n");
-    RUN_SILENT(rc = read_optional_date("opt-d:", out, sizeof out));
-    CHECK_TRUE("blank->0", rc==0 && strcmp(out,"keep")==0);
-
-    set_stdin_from_string("15-08-2024\n");
-    RUN_SILENT(rc = read_optional_date("opt-d:", out, sizeof out));
-    CHECK_TRUE("set date", rc==1 && strcmp(out,"15-08-2024")==0);
-}
-
-// read_menu_choice (invalid inputs then valid)
-static void t_read_menu_choice(void) {
-    int c;
-    set_stdin_from_string("0\nx\n6\n2\n");
-    RUN_SILENT(c = read_menu_choice(1,5));
-    CHECK_EQ_INT("menu=2", 2, c);
-}
-
-// ensure_csv_header + orderIDExists
-static void t_ensure_and_exists(void) {
-    delete_file_if_exists(CSV_FILE);
-    RUN_SILENT(ensure_csv_header());
-    char* s = read_whole_file(CSV_FILE);
-    CHECK_TRUE("file exists", s!=NULL);
-    if (s) {
-        CHECK_TRUE("has header", strstr(s,"orderid,customername,productname,quantity,price,orderdate")!=NULL);
-        free(s);
-    }
-    CHECK_TRUE("id 999 not exist", !orderIDExists(999));
-}
-
-// Addcsv (append a new row)
-static void t_Addcsv(void) {
-    write_text_file(CSV_FILE, "orderid,customername,productname,quantity,price,orderdate\n");
-    set_stdin_from_string("101\nAlice\nWidget\n2\n9.99\n01-01-2024\n");
-    RUN_SILENT(Addcsv());
-    char* s = read_whole_file(CSV_FILE);
-    CHECK_TRUE("row added", s && strstr(s, "101,Alice,Widget,2,9.99,01-01-2024")!=NULL);
-    if (s) free(s);
-    CHECK_TRUE("exists(101)", orderIDExists(101));
-}
-
-// searchByOrderID (smoke)
-static void t_searchByOrderID(void) {
-    write_text_file(CSV_FILE,
-        "orderid,customername,productname,quantity,price,orderdate\n"
-        "200,Bob,Gadget,1,5.50,02-01-2024\n"
-        "201,Cara,Tool,3,7.00,03-01-2024\n");
-    set_stdin_from_string("200\n");
-    RUN_SILENT(searchByOrderID());
-}
-
-// searchByProductName (smoke)
-static void t_searchByProductName(void) {
-    write_text_file(CSV_FILE,
-        "orderid,customername,productname,quantity,price,orderdate\n"
-        "300,Dan,WiDGet,1,8.00,04-01-2024\n"
-        "301,Eve,Thing,2,6.00,05-01-2024\n");
-    set_stdin_from_string("widget\n");
-    RUN_SILENT(searchByProductName());
-}
-
-// searchMenu (go in and immediately back out)
-static void t_searchMenu(void) {
-    set_stdin_from_string("3\n");
-    RUN_SILENT(searchMenu());
-}
-
-// updateOrderByID (change just product; others blank)
-static void t_updateOrderByID(void) {
-    write_text_file(CSV_FILE,
-        "orderid,customername,productname,quantity,price,orderdate\n"
-        "400,Fay,Item,5,10.00,06-01-2024\n");
-    set_stdin_from_string(
-        "400\n"     // id to update
-        "\n"        // keep customer
-        "NewItem\n" // new product
-        "\n"        // keep qty
-        "\n"        // keep price
-        "\n"        // keep date
-    );
-    RUN_SILENT(updateOrderByID());
-    char* s = read_whole_file(CSV_FILE);
-    CHECK_TRUE("product changed", s && strstr(s, "400,Fay,NewItem,5,10.00,06-01-2024")!=NULL);
-    if (s) free(s);
-}
-
-// deleteByOrderID (two matches; choose 1; confirm Y)
-static void t_deleteByOrderID(void) {
-    write_text_file(CSV_FILE,
-        "orderid,customername,productname,quantity,price,orderdate\n"
-        "500,Ann,AAA,1,1.00,01-02-2024\n"
-        "500,Ben,BBB,2,2.00,02-02-2024\n"
-        "501,Cid,CCC,3,3.00,03-02-2024\n");
-    set_stdin_from_string("500\n1\nY\n");
-    RUN_SILENT(deleteByOrderID());
-    char* s = read_whole_file(CSV_FILE);
-    CHECK_TRUE("deleted one of 500", s && strstr(s,"500,Ann,AAA,1,1.00,01-02-2024")==NULL);
-    CHECK_TRUE("still has other 500", s && strstr(s,"500,Ben,BBB,2,2.00,02-02-2024")!=NULL);
-    CHECK_TRUE("kept 501", s && strstr(s,"501,Cid,CCC,3,3.00,03-02-2024")!=NULL);
-    if (s) free(s);
-}
-
-// ------------------- runner ----------------------------------------------
-int main(void) {
-    // string & parsing
-    t_chomp();
-    t_sanitize_commas();
-    t_lowercase();
-    t_line_starts_with_digit();
-    t_parse_csv_line();
-    t_is_valid_date_str();
-
-    // input helpers
-    t_read_line();
-    t_try_parse_int();
-    t_try_parse_float();
-    t_read_int_loop();
-    t_read_float_loop();
-    t_read_text_loop();
-    t_read_optional_int();
-    t_read_optional_float();
-    t_read_optional_text();
-    t_read_date_loop();
-    t_read_optional_date();
-    t_read_menu_choice();
-
-    // CSV + features
-    t_ensure_and_exists();
-    t_Addcsv();
-    t_searchByOrderID();
-    t_searchByProductName();
-    t_searchMenu();
-    t_updateOrderByID();
-    t_deleteByOrderID();
-
-    printf("\nTests run: %d, failed: %d\n", tests_run, tests_failed);
-    if (tests_failed == 0) {
-        printf("[OK] All tests passed.\n");
-        return 0;
-    } else {
-        printf("[X] Some tests failed.\n");
-        return 1;
-    }
-}
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <ctype.h>
+#include <errno.h>
+#ifdef __linux__
+#include <sys/wait.h>
+#endif
+
+#define UNIT_TESTING
+#include "OrderManagerForUnittest.c"   // include implementation so we can hit static helpers
+
+// ------------------- mini harness (prints only on FAIL) -------------------
+static int tests_run = 0, tests_failed = 0;
+
+#define CHECK_TRUE(msg, expr) do { \
+    ++tests_run; \
+    if (!(expr)) { ++tests_failed; \
+        printf("[FAIL] %s (at %s:%d)\n", msg, __FILE__, __LINE__); \
+    } \
+} while (0)
+
+#define CHECK_EQ_INT(msg, exp, got) do { \
+    ++tests_run; \
+    if ((int)(exp) != (int)(got)) { ++tests_failed; \
+        printf("[FAIL] %s: expected %d, got %d (at %s:%d)\n", msg, (int)(exp), (int)(got), __FILE__, __LINE__); \
+    } \
+} while (0)
+
+#define CHECK_EQ_STR(msg, exp, got) do { \
+    ++tests_run; \
+    if (strcmp((exp),(got)) != 0) { ++tests_failed; \
+        printf("[FAIL] %s: expected \"%s\", got \"%s\" (at %s:%d)\n", msg, (exp), (got), __FILE__, __LINE__); \
+    } \
+} while (0)
+
+// ------------------- utilities: files, stdin, mute output -----------------
+static void delete_file_if_exists(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f) { fclose(f); remove(path); }
+}
+
+static void write_text_file(const char* path, const char* content) {
+    FILE* f = fopen(path, "w");
+    assert(f && "cannot open file for writing");
+    fputs(content, f);
+    fclose(f);
+}
+
+static char* read_whole_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = (char*)malloc(n + 1);
+    fread(buf, 1, n, f);
+    buf[n] = '\0';
+    fclose(f);
+    return buf;
+}
+
+// feed next test input via a temp file
+static void set_stdin_from_string(const char* s) {
+    const char* in = "tmp_stdin.txt";
+    write_text_file(in, s);
+    freopen(in, "r", stdin);
+}
+
+#ifdef _WIN32
+  #define DEV_NULL    "NUL"
+  #define CONSOLE_OUT "CON"
+#else
+  #define DEV_NULL    "/dev/null"
+  #define CONSOLE_OUT "/dev/tty"
+#endif
+
+// Mute/unmute app outputs; keep harness output visible.
+static void mute_outputs_begin(void)  { freopen(DEV_NULL, "w", stdout); freopen(DEV_NULL, "w", stderr); }
+static void mute_outputs_end(void)    { freopen(CONSOLE_OUT, "w", stdout); freopen(CONSOLE_OUT, "w", stderr); }
+
+// Run a statement with app output muted (do NOT wrap CHECK_* inside)
+#define RUN_SILENT(stmt) do { mute_outputs_begin(); stmt; mute_outputs_end(); } while (0)
+
+// write CSV_FILE and reload the in-memory store from it
+static void write_csv_fixture(const char* content) {
+    delete_file_if_exists(WAL_FILE);
+    write_text_file(CSV_FILE, content);
+    RUN_SILENT(store_load());
+}
+
+// ------------------- tests for each function ------------------------------
+
+// chomp
+static void t_chomp(void) {
+    char a[32]="hi\n", b[32]="x\r\n", c[32]="nope";
+    chomp(a); chomp(b); chomp(c);
+    CHECK_EQ_STR("chomp \\n", "hi", a);
+    CHECK_EQ_STR("chomp \\r\\n", "x", b);
+    CHECK_EQ_STR("chomp none", "nope", c);
+}
+
+// sanitize_commas
+static void t_sanitize_commas(void) {
+    char s[32] = "a,b,,c";
+    sanitize_commas(s);
+    CHECK_EQ_STR("commas->spaces", "a b  c", s);
+}
+
+// lowercase
+static void t_lowercase(void) {
+    char s[32] = "HeLLo-123";
+    lowercase(s);
+    CHECK_EQ_STR("lowercase", "hello-123", s);
+}
+
+// line_starts_with_digit
+static void t_line_starts_with_digit(void) {
+    CHECK_TRUE("digit", line_starts_with_digit("1,abc"));
+    CHECK_TRUE("spaces+digit", line_starts_with_digit("   9,x"));
+    CHECK_TRUE("no", !line_starts_with_digit("id,1"));
+    CHECK_TRUE("empty", !line_starts_with_digit(""));
+}
+
+// parse_csv_line
+static void t_parse_csv_line(void) {
+    const char* line = "42,John Doe,Widget X,5,12.34,01-01-2024";
+    int id,qty; float price; char customer[50],product[50],date[20];
+    int ok = parse_csv_line(line, &id, customer, product, &qty, &price, date);
+    CHECK_TRUE("parse ok", ok==1);
+    CHECK_EQ_INT("id", 42, id);
+    CHECK_EQ_INT("qty", 5, qty);
+    CHECK_TRUE("price", fabsf(price-12.34f) < 1e-5f);
+    CHECK_EQ_STR("customer", "John Doe", customer);
+    CHECK_EQ_STR("product",  "Widget X", product);
+    CHECK_EQ_STR("date",     "01-01-2024", date);
+
+    const char* bad = "x,y,z";
+    ok = parse_csv_line(bad, &id, customer, product, &qty, &price, date);
+    CHECK_TRUE("parse bad -> 0", ok==0);
+}
+
+// csv_tokenize (slices into the line; sscanf-compatible edge cases)
+static void t_csv_tokenize(void) {
+    const char* line = " 7 , Ann Lee ,Nut,3, 1.5 ,01-02-2024\r\nnext";
+    CsvRow r;
+    int ok = csv_tokenize(line, strlen(line), &r);
+    CHECK_TRUE("tokenize ok", ok);
+    CHECK_TRUE("id/qty", r.orderid == 7 && r.qty == 3);
+    CHECK_TRUE("price", fabsf(r.price - 1.5f) < 1e-6f);
+    CHECK_TRUE("customer keeps inner/trailing space", r.customer_len == 8 && strncmp(r.customer, "Ann Lee ", 8) == 0);
+    CHECK_TRUE("date stops at newline", r.date_len == 11 && strncmp(r.date, "01-02-2024\r", 11) == 0);
+
+    // slice bound is honoured even without a terminator
+    CHECK_TRUE("bounded", !csv_tokenize("1,a,b,2,3.0,x", 11, &r));
+    CHECK_TRUE("exponent", csv_tokenize("1,a,b,2,2e2,x", 13, &r) && r.price == 200.0f);
+    CHECK_TRUE("dangling exponent like scanf", csv_tokenize("1,a,b,2,7e,x", 12, &r) && r.price == 7.0f);
+    CHECK_TRUE("empty field", !csv_tokenize("1,,b,2,3,x", 10, &r));
+    CHECK_TRUE("over-long customer", !csv_tokenize(
+        "1,aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa,b,2,3,x", 59, &r));
+    CHECK_TRUE("long id digits", csv_tokenize("123456789012,a,b,2,3,x", 23, &r)
+               && r.orderid == (int)123456789012LL);
+}
+
+// is_valid_date_str
+static void t_is_valid_date_str(void) {
+    CHECK_TRUE("ok",  is_valid_date_str("15-08-2024"));
+    CHECK_TRUE("leap",is_valid_date_str("29-02-2024"));
+    CHECK_TRUE("no 29-02 in 2023", !is_valid_date_str("29-02-2023"));
+    CHECK_TRUE("bad month", !is_valid_date_str("01-13-2024"));
+    CHECK_TRUE("bad day",   !is_valid_date_str("32-01-2024"));
+    CHECK_TRUE("format",    !is_valid_date_str("2024-01-01"));
+}
+
+// date_pack / date_format (packed yyyymmdd, scanf-style input rules)
+static void t_date_pack(void) {
+    CHECK_EQ_INT("padded", 20240815, (int)date_pack("15-08-2024", 10));
+    CHECK_EQ_INT("unpadded", 20230913, (int)date_pack("13-9-2023", 9));
+    CHECK_EQ_INT("trailing ignored", 20240101, (int)date_pack("01-01-2024\r", 11));
+    CHECK_EQ_INT("leap", 20000229, (int)date_pack("29-02-2000", 10));
+    CHECK_EQ_INT("no leap 1900", 0, (int)date_pack("29-02-1900", 10));
+    CHECK_EQ_INT("bad month", 0, (int)date_pack("01-00-2024", 10));
+    CHECK_EQ_INT("wrong order", 0, (int)date_pack("2024-01-01", 10));
+    CHECK_EQ_INT("slice bound", 0, (int)date_pack("01-01-2024", 6));
+    CHECK_TRUE("packed dates compare as ints", date_pack("31-12-2023", 10) < date_pack("01-01-2024", 10));
+
+    char buf[16];
+    date_format(20230913, buf, sizeof buf);
+    CHECK_EQ_STR("format pads", "13-09-2023", buf);
+}
+
+// read_line (smoke)
+static void t_read_line(void) {
+    char buf[64];
+    set_stdin_from_string("hello world\n");
+    RUN_SILENT(read_line("prompt: ", buf, sizeof buf));
+    CHECK_EQ_STR("read_line", "hello world", buf);
+}
+
+// try_parse_int
+static void t_try_parse_int(void) {
+    int v;
+    CHECK_TRUE("int", try_parse_int("123", &v) && v==123);
+    CHECK_TRUE("neg", try_parse_int("-7", &v)  && v==-7);
+    CHECK_TRUE("bad", !try_parse_int("1x", &v));
+    CHECK_TRUE("empty", !try_parse_int("", &v));
+    // overflow guard
+    char big[64];
+    long long too_big = (long long)INT_MAX + 1LL;
+    snprintf(big, sizeof big, "%lld", too_big);
+    CHECK_TRUE("overflow rejected", !try_parse_int(big, &v));
+}
+
+// try_parse_float
+static void t_try_parse_float(void) {
+    float f;
+    CHECK_TRUE("ok", try_parse_float("3.14", &f) && fabsf(f-3.14f)<1e-5f);
+    CHECK_TRUE("neg", try_parse_float("-2.5", &f) && fabsf(f+2.5f)<1e-5f);
+    CHECK_TRUE("bad", !try_parse_float("1.2.3", &f));
+    CHECK_TRUE("empty", !try_parse_float("", &f));
+}
+
+// read_int_loop (invalid then valid)
+static void t_read_int_loop(void) {
+    int v, rc;
+    set_stdin_from_string("abc\n5\n");
+    RUN_SILENT(rc = read_int_loop("int:", &v, 0, 0));
+    CHECK_TRUE("read_int_loop", rc==1 && v==5);
+}
+
+// read_float_loop (invalid then valid)
+static void t_read_float_loop(void) {
+    float v; int rc;
+    set_stdin_from_string("x\n2.50\n");
+    RUN_SILENT(rc = read_float_loop("flt:", &v, 1, 0.0f));
+    CHECK_TRUE("read_float_loop", rc==1 && fabsf(v-2.5f)<1e-5f);
+}
+
+// read_text_loop (commas sanitized)
+static void t_read_text_loop(void) {
+    char out[32];
+    set_stdin_from_string("A,b,c\n");
+    RUN_SILENT(read_text_loop("txt:", out, sizeof out));
+    CHECK_EQ_STR("sanitized", "A b c", out);
+}
+
+// read_optional_int
+static void t_read_optional_int(void) {
+    int out=99; int rc;
+    set_stdin_from_string("\n");           // blank -> keep
+    RUN_SILENT(rc = read_optional_int("opt-int:", &out));
+    CHECK_TRUE("blank -> 0", rc==0 && out==99);
+
+    set_stdin_from_string("123\n");
+    RUN_SILENT(rc = read_optional_int("opt-int:", &out));
+    CHECK_TRUE("set 123", rc==1 && out==123);
+}
+
+// read_optional_float
+static void t_read_optional_float(void) {
+    float out=1.0f; int rc;
+    set_stdin_from_string("\n");
+    RUN_SILENT(rc = read_optional_float("opt-f:", &out));
+    CHECK_TRUE("blank -> 0", rc==0 && fabsf(out-1.0f)<1e-5f);
+
+    set_stdin_from_string("4.75\n");
+    RUN_SILENT(rc = read_optional_float("opt-f:", &out));
+    CHECK_TRUE("set 4.75", rc==1 && fabsf(out-4.75f)<1e-5f);
+}
+
+// read_optional_text
+static void t_read_optional_text(void) {
+    char out[32]="keep"; int rc;
+    set_stdin_from_string("\n");
+    RUN_SILENT(rc = read_optional_text("opt-t:", out, sizeof out));
+    CHECK_TRUE("blank -> 0", rc==0 && strcmp(out,"keep")==0);
+
+    set_stdin_from_string("x,y\n");
+    RUN_SILENT(rc = read_optional_text("opt-t:", out, sizeof out));
+    CHECK_TRUE("set", rc==1 && strcmp(out,"x y")==0);
+}
+
+// read_date_loop (invalid then valid)
+static void t_read_date_loop(void) {
+    char out[32];
+    set_stdin_from_string("2024-01-01\n01-01-2024\n");
+    RUN_SILENT(read_date_loop("date:", out, sizeof out));
+    CHECK_EQ_STR("date ok", "01-01-2024", out);
+}
+
+// read_optional_date
+static void t_read_optional_date(void) {
+    char out[32]="keep"; int rc;
+    set_stdin_from_string("\n");
+    RUN_SILENT(rc = read_optional_date("opt-d:", out, sizeof out));
+    CHECK_TRUE("blank->0", rc==0 && strcmp(out,"keep")==0);
+
+    set_stdin_from_string("15-08-2024\n");
+    RUN_SILENT(rc = read_optional_date("opt-d:", out, sizeof out));
+    CHECK_TRUE("set date", rc==1 && strcmp(out,"15-08-2024")==0);
+}
+
+// read_menu_choice (invalid inputs then valid)
+static void t_read_menu_choice(void) {
+    int c;
+    set_stdin_from_string("0\nx\n6\n2\n");
+    RUN_SILENT(c = read_menu_choice(1,5));
+    CHECK_EQ_INT("menu=2", 2, c);
+}
+
+// ensure_csv_header + orderIDExists
+static void t_ensure_and_exists(void) {
+    delete_file_if_exists(CSV_FILE);
+    RUN_SILENT(ensure_csv_header());
+    RUN_SILENT(store_load());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("file exists", s!=NULL);
+    if (s) {
+        CHECK_TRUE("has header", strstr(s,"orderid,customername,productname,quantity,price,orderdate")!=NULL);
+        free(s);
+    }
+    CHECK_TRUE("id 999 not exist", !orderIDExists(999));
+}
+
+// reader_open / reader_next (mapped and stdio paths yield the same lines)
+static void t_line_reader(void) {
+    char longline[700];
+    memset(longline, 'x', sizeof longline - 2);
+    longline[sizeof longline - 2] = '\n';
+    longline[sizeof longline - 1] = '\0';
+    FILE* f = fopen("reader_test.txt", "wb");
+    fputs("a,b\n", f);
+    fputs(longline, f);
+    fputs("last", f);     // no trailing newline
+    fclose(f);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        LineReader r;
+        int ok = pass ? reader_open_stream(&r, "reader_test.txt", (size_t)-1)
+                      : reader_open(&r, "reader_test.txt", (size_t)-1);
+        CHECK_TRUE("reader open", ok);
+        const char* line; size_t len, off;
+        int n = 0;
+        size_t lens[4] = {0}, offs[4] = {0};
+        while (n < 4 && reader_next(&r, &line, &len, &off)) { lens[n] = len; offs[n] = off; n++; }
+        reader_close(&r);
+        CHECK_EQ_INT("line count", 3, n);
+        CHECK_TRUE("lengths", lens[0] == 4 && lens[1] == 699 && lens[2] == 4);
+        CHECK_TRUE("offsets", offs[1] == 4 && offs[2] == 703);
+    }
+
+    // stop offset bounds the walk (compaction snapshots)
+    LineReader r;
+    reader_open(&r, "reader_test.txt", 4);
+    const char* line; size_t len, off;
+    int n = 0;
+    while (reader_next(&r, &line, &len, &off)) n++;
+    reader_close(&r);
+    CHECK_EQ_INT("bounded", 1, n);
+    remove("reader_test.txt");
+}
+
+// store_load + store_checkpoint (header and unparsable lines survive a rewrite)
+static void t_store_load_save(void) {
+    const char* csv =
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "600,Gus,Nut,4,0.50,07-02-2024\n"
+        "not,a,row\n"
+        "601,Hal,Bolt,1,2.25,08-02-2024\n";
+    write_csv_fixture(csv);
+    CHECK_EQ_INT("rows loaded", 3, (int)store.len);
+    CHECK_TRUE("header kept", store.header && strncmp(store.header, "orderid,", 8)==0);
+    CHECK_TRUE("raw kept", store.rows[1].raw && strcmp(store.rows[1].raw, "not,a,row\n")==0);
+    CHECK_EQ_INT("row id", 601, store.rows[2].orderid);
+
+    int ok;
+    RUN_SILENT(ok = store_checkpoint());
+    CHECK_TRUE("checkpoint ok", ok);
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("round trip", s && strcmp(s, csv)==0);
+    if (s) free(s);
+}
+
+// rows whose date is no calendar date are still orders: found by ID, kept verbatim, not dated
+static void t_store_bad_dates(void) {
+    const char* csv =
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "610,Ann,Nut,1,0.50,2023-01-05\n"
+        "611,Ben,Bolt,2,1.25,31-02-2023\n"
+        "612,Cat,Pin,3,0.10,05-01-2023\n";
+    write_csv_fixture(csv);
+    CHECK_TRUE("orders, not raw lines", !row_is_line(&store.rows[0]) && !row_is_line(&store.rows[1]));
+    CHECK_TRUE("ids found", orderIDExists(610) && orderIDExists(611));
+    CHECK_TRUE("date text kept", store.rows[0].date == 0 && strcmp(store.rows[1].raw, "31-02-2023") == 0);
+    CHECK_TRUE("no room taken in every row", sizeof(Order) <= 128);
+
+    set_stdin_from_string("611\n613\nDee\nCog\n1\n1\n01-01-2024\n");
+    RUN_SILENT(Addcsv());
+    CHECK_TRUE("duplicate id refused", orderIDExists(613) && store.len == 4 && store.rows[3].orderid == 613);
+
+    CHECK_TRUE("date index skips them", dates_build() && store.dates.len == 2);
+    Order o;
+    int rc;
+    delete_file_if_exists(IDX_FILE);
+    RUN_SILENT(rc = idx_file_lookup(610, &o));
+    CHECK_TRUE("sidecar finds 610", rc == 1 && strcmp(o.raw, "2023-01-05") == 0);
+    free(o.raw);
+    delete_file_if_exists(IDX_FILE);
+
+    char line[256];
+    format_order(line, sizeof line, &store.rows[1]);
+    CHECK_TRUE("printed as in the file", strcmp(line, "611,Ben,Bolt,2,1.25,31-02-2023\n") == 0);
+
+    int ok;
+    RUN_SILENT(ok = store_checkpoint());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("round trip", ok && s && strncmp(s, csv, strlen(csv)) == 0);
+    free(s);
+
+    // an edit keeps the text until it sets a real date, and the log replays either way
+    set_stdin_from_string("611\n\n\n5\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("610\n\n\n\n\n06-01-2023\n");
+    RUN_SILENT(updateOrderByID());
+    RUN_SILENT(store_load());
+    CHECK_TRUE("text kept through an edit", store.rows[1].qty == 5 && store.rows[1].date == 0
+               && strcmp(store.rows[1].raw, "31-02-2023") == 0);
+    CHECK_TRUE("real date replaces the text", store.rows[0].date == 20230106 && !store.rows[0].raw);
+}
+
+// idx_insert / idx_first / idx_matches / idx_remove (duplicates + growth)
+static void t_id_index(void) {
+    IdIndex ix = {0};
+    for (int i = 0; i < 1000; ++i) idx_insert(&ix, i, (size_t)i);
+    idx_insert(&ix, 7, 2000);
+    idx_insert(&ix, 7, 1500);
+    CHECK_EQ_INT("first of 7", 7, (int)idx_first(&ix, 7));
+    CHECK_TRUE("missing", idx_first(&ix, 5000) == ID_EMPTY);
+
+    size_t* hits;
+    size_t n = idx_matches(&ix, 7, &hits);
+    CHECK_EQ_INT("dup count", 3, (int)n);
+    CHECK_TRUE("file order", n == 3 && hits[0] == 7 && hits[1] == 1500 && hits[2] == 2000);
+    free(hits);
+
+    idx_remove(&ix, 7, 7);
+    CHECK_EQ_INT("first after remove", 1500, (int)idx_first(&ix, 7));
+    CHECK_EQ_INT("999 still there", 999, (int)idx_first(&ix, 999));
+    idx_free(&ix);
+}
+
+// idx_file_lookup (sidecar index, rebuilt when the CSV changes)
+static void t_idx_file_lookup(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "700,Ivy,Lamp,1,4.00,09-02-2024\n"
+        "702,Jon,Desk,1,90.00,10-02-2024\n"
+        "701,Kim,Chair,2,45.50,11-02-2024\n"
+        "701,Lou,Chair,1,45.50,12-02-2024\n");
+    delete_file_if_exists(IDX_FILE);
+    Order o;
+    int rc;
+    RUN_SILENT(rc = idx_file_lookup(701, &o));
+    CHECK_TRUE("found 701", rc==1 && strcmp(o.customer, "Kim")==0);
+    RUN_SILENT(rc = idx_file_lookup(703, &o));
+    CHECK_TRUE("703 missing", rc==0);
+
+    // append behind the index's back; stale index must be rebuilt
+    FILE* f = fopen(CSV_FILE, "a");
+    fputs("703,Max,Shelf,3,12.00,13-02-2024\n", f);
+    fclose(f);
+    RUN_SILENT(rc = idx_file_lookup(703, &o));
+    CHECK_TRUE("found 703 after rebuild", rc==1 && strcmp(o.product, "Shelf")==0);
+    delete_file_if_exists(IDX_FILE);
+}
+
+// Addcsv (append a new row)
+static void t_Addcsv(void) {
+    write_csv_fixture("orderid,customername,productname,quantity,price,orderdate\n");
+    set_stdin_from_string("101\nAlice\nWidget\n2\n9.99\n01-01-2024\n");
+    RUN_SILENT(Addcsv());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("row added", s && strstr(s, "101,Alice,Widget,2,9.99,01-01-2024")!=NULL);
+    if (s) free(s);
+    CHECK_TRUE("exists(101)", orderIDExists(101));
+}
+
+// searchByOrderID (smoke)
+static void t_searchByOrderID(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "200,Bob,Gadget,1,5.50,02-01-2024\n"
+        "201,Cara,Tool,3,7.00,03-01-2024\n");
+    set_stdin_from_string("200\n");
+    RUN_SILENT(searchByOrderID());
+}
+
+// searchByProductName (smoke)
+static void t_searchByProductName(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "300,Dan,WiDGet,1,8.00,04-01-2024\n"
+        "301,Eve,Thing,2,6.00,05-01-2024\n");
+    set_stdin_from_string("widget\n");
+    RUN_SILENT(searchByProductName());
+}
+
+// grams_build / grams_candidates (index follows add/update/delete)
+static void t_gram_index(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "320,Ada,Hex Bolt,1,1.00,05-01-2024\n"
+        "321,Bea,Nut,1,1.00,01-01-2024\n"
+        "322,Cy,BOLT cutter,1,1.00,03-01-2024\n"
+        "323,Di,Lob tool,1,1.00,03-01-2024\n");
+    set_stdin_from_string("bolt\n");
+    RUN_SILENT(searchByProductName());
+    CHECK_TRUE("built on first query", store.grams.built);
+
+    uint32_t *c;
+    size_t n = grams_candidates("bolt", &c);
+    CHECK_TRUE("bolt candidates", n == 2 && c[0] == 0 && c[1] == 2);
+    free(c);
+    n = grams_candidates("zzz", &c);
+    CHECK_EQ_INT("unknown gram", 0, (int)n);
+    free(c);
+    CHECK_TRUE("short needle not indexed", grams_candidates("bo", &c) == (size_t)-1);
+
+    set_stdin_from_string("324\nEd\nEyebolt\n1\n1.00\n02-01-2024\n");
+    RUN_SILENT(Addcsv());
+    set_stdin_from_string("320\n\nHex nut\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("322\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    n = grams_candidates("bolt", &c);
+    CHECK_TRUE("kept in step", n == 1 && c[0] == 4);
+    free(c);
+    n = grams_candidates("nut", &c);
+    CHECK_TRUE("renamed row found", n == 2 && c[0] == 0 && c[1] == 1);
+    free(c);
+}
+
+// find_* kernels agree with strstr; fold_scan follows add/update/delete
+static void t_fold_scan(void) {
+    FindFn impls[3] = { find_scalar, find_pick(), find_scalar };
+#if defined(FOLD_SIMD) && defined(__SSE2__)
+    impls[2] = find_sse2;
+#endif
+    char hay[200];
+    int agree = 1;
+    srand(7);
+    for (int t = 0; t < 2000; ++t) {
+        size_t n = (size_t)(rand() % 150);
+        for (size_t i = 0; i < n; ++i) hay[i] = "abc\0"[rand() % 4];
+        hay[n] = '\0';
+        char nd[4] = { "abc"[rand() % 3], "abc"[rand() % 3], "abc"[rand() % 3], 0 };
+        nd[1 + rand() % 3] = '\0';
+        size_t m = strlen(nd);
+        const char *want = NULL;
+        for (size_t i = 0; i + m <= n && !want; ++i) if (memcmp(hay + i, nd, m) == 0) want = hay + i;
+        for (int k = 0; k < 3; ++k) if (impls[k](hay, n, nd, m) != want) agree = 0;
+    }
+    CHECK_TRUE("kernels agree", agree);
+
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "330,Ada,Pipe,1,1.00,05-01-2024\n"
+        "331,Bea,PIPE PIPE,1,1.00,01-01-2024\n"
+        "332,Cy,Tap,1,1.00,03-01-2024\n");
+    size_t *h;
+    size_t n = fold_scan("pi", &h);
+    CHECK_TRUE("one hit per row", n == 2 && h[0] == 0 && h[1] == 1);
+    free(h);
+
+    set_stdin_from_string("330\n\nTap\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("333\nDi\nPi\n1\n1.00\n02-01-2024\n");
+    RUN_SILENT(Addcsv());
+    set_stdin_from_string("331\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    n = fold_scan("ta", &h);
+    CHECK_TRUE("rewritten row in file order", n == 2 && h[0] == 0 && h[1] == 2);
+    free(h);
+    n = fold_scan("pi", &h);
+    CHECK_TRUE("dropped rows gone", n == 1 && h[0] == 3);
+    free(h);
+    set_stdin_from_string("p\n");
+    RUN_SILENT(searchByProductName());
+}
+
+// load_parallel / fold_scan over the worker pool give the sequential answers
+static void t_scan_parallel(void) {
+    static char csv[32768];
+    size_t n = (size_t)sprintf(csv, "orderid,customername,productname,quantity,price,orderdate\n");
+    for (int i = 0; i < 300; ++i) {
+        if (i == 150) n += (size_t)sprintf(csv + n, "not,an,order\n");
+        n += (size_t)sprintf(csv + n, "%d,C%d,%s %d,1,1.00,%02d-01-2024\n",
+                             400 + i, i, i % 3 ? "Gear" : "Hex Pin", i, 1 + i % 28);
+    }
+    write_csv_fixture(csv);
+    size_t seq_len = store.len, *seq, *par;
+    size_t nseq = fold_scan("pin", &seq);
+
+    scan_threads = 4;
+    scan_part_bytes = 64;
+    RUN_SILENT(store_load());
+    size_t npar = fold_scan("pin", &par);
+    int same = store.len == seq_len && store.rows[150].raw && !store.rows[151].raw;
+    for (size_t i = 0; same && i < store.len; ++i)
+        if (!store.rows[i].raw && store.rows[i].orderid != (int)(400 + i - (i > 150))) same = 0;
+    CHECK_TRUE("parallel load keeps file order", same);
+    CHECK_TRUE("parallel scan matches", nseq == 100 && npar == nseq && memcmp(seq, par, nseq * sizeof *seq) == 0);
+    free(seq);
+    free(par);
+
+    set_stdin_from_string("ex\n");
+    RUN_SILENT(searchByProductName());
+    scan_threads = 1;
+    scan_part_bytes = 1 << 20;
+}
+
+// import_csv: header skipped, bad rows and duplicate IDs rejected, the rest appended
+static void t_import_csv(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "500,Ada,Box,1,1.00,05-01-2024\n");
+    write_text_file("import_test.csv",
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "501,Bea,Bag,2,3.50,01-01-2024\n"
+        "500,Dup,Old,1,1.00,01-01-2024\n"     // already stored
+        "502,Cy,Cap,1,1.00,31-02-2024\n"      // no such date
+        "503,Di,Cog,-1,1.00,01-01-2024\n"     // negative quantity
+        "504,Ed,Die,1\n"                       // short row
+        "\n"
+        "505,Fa,Fan,1,2.00,02-01-2024\n"
+        "505,Gi,Fan,1,2.00,02-01-2024\n");    // duplicate within the batch
+    int ok;
+    RUN_SILENT(ok = import_csv("import_test.csv"));
+    CHECK_TRUE("import ok", ok);
+    CHECK_TRUE("accepted rows stored", orderIDExists(501) && orderIDExists(505) && !orderIDExists(502));
+    CHECK_EQ_INT("rows in memory", 3, (int)store.len);
+
+    char *txt = read_whole_file(CSV_FILE);
+    CHECK_TRUE("appended once, in order", txt && strstr(txt, "501,Bea,Bag,2,3.50,01-01-2024\n505,Fa,Fan,1,2.00,02-01-2024\n")
+                                          && !strstr(txt, "Gi"));
+    free(txt);
+    RUN_SILENT(store_load());
+    CHECK_EQ_INT("survives reload", 3, (int)store.len);
+
+    RUN_SILENT(ok = import_csv("no_such_batch.csv"));
+    CHECK_TRUE("missing file fails", !ok);
+
+    // many small blocks across several parsers: order and first-wins still hold
+    static char batch[16384];
+    size_t n = 0;
+    for (int i = 0; i < 200; ++i)
+        n += (size_t)sprintf(batch + n, "%d,C%d,P%d,1,1.00,01-01-2024\n", 600 + i % 150, i, i);
+    n += (size_t)sprintf(batch + n, "999,C,%0600d,1,1.00,01-01-2024", 7);   // too long, no newline
+    write_text_file("import_test.csv", batch);
+    scan_threads = 6;
+    import_block_bytes = 100;
+    RUN_SILENT(ok = import_csv("import_test.csv"));
+    scan_threads = 1;
+    import_block_bytes = 1 << 20;
+    CHECK_TRUE("pipelined import ok", ok);
+    CHECK_EQ_INT("first 150 kept", 3 + 150, (int)store.len);
+    CHECK_TRUE("first occurrence wins", strcmp(store.rows[3 + 149].product, "P149") == 0 &&
+                                        !orderIDExists(999));
+    txt = read_whole_file(CSV_FILE);
+    CHECK_TRUE("file order", txt && strstr(txt, "600,C0,P0,1,1.00,01-01-2024\n601,C1,P1,") && !strstr(txt, ",C150,"));
+    free(txt);
+    remove("import_test.csv");
+}
+
+// batch_run: each command answers OK <n> + rows, or ERR <reason>
+static void t_batch_run(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "700,Ada,Hex Bolt,1,1.00,05-01-2024\n");
+    write_text_file("batch_in.txt",
+        "# comment\n"
+        "ADD 701,Bea,Wing Nut,2,3.50,01-01-2024\n"
+        "ADD 701,Bea,Wing Nut,2,3.50,01-01-2024\n"
+        "GET 701\n"
+        "FIND bolt\n"
+        "\n"
+        "UPDATE 700,,Hex Bolt XL,5,,\n"
+        "UPDATE 700,,,-1,,\n"
+        "DELETE 701\n"
+        "GET 701\n"
+        "DELETE 999\n"
+        "FROB\n");
+    FILE *in = fopen("batch_in.txt", "r"), *out = fopen("batch_out.txt", "w");
+    int ok = in && out && batch_run(in, out);
+    if (in) fclose(in);
+    if (out) fclose(out);
+    CHECK_TRUE("batch ran", ok);
+
+    char *txt = read_whole_file("batch_out.txt");
+    CHECK_EQ_STR("batch replies",
+        "OK 1\n701,Bea,Wing Nut,2,3.50,01-01-2024\n"
+        "ERR duplicate order id\n"
+        "OK 1\n701,Bea,Wing Nut,2,3.50,01-01-2024\n"
+        "OK 1\n700,Ada,Hex Bolt,1,1.00,05-01-2024\n"
+        "OK 1\n700,Ada,Hex Bolt XL,5,1.00,05-01-2024\n"
+        "ERR bad quantity\n"
+        "OK 1\n701,Bea,Wing Nut,2,3.50,01-01-2024\n"
+        "OK 0\n"
+        "ERR not found\n"
+        "ERR unknown command\n", txt ? txt : "");
+    free(txt);
+    RUN_SILENT(store_load());
+    CHECK_TRUE("changes persisted", store.len == 2 && !orderIDExists(701) &&
+                                    strcmp(store.rows[0].product, "Hex Bolt XL") == 0);
+    remove("batch_in.txt");
+    remove("batch_out.txt");
+}
+
+// serve: framed commands over the Unix socket, pipelined frames answered in order
+#ifdef __linux__
+static int frame_send(int fd, const char *cmd) {
+    size_t n = strlen(cmd);
+    unsigned char h[4] = { (unsigned char)(n >> 24), (unsigned char)(n >> 16), (unsigned char)(n >> 8), (unsigned char)n };
+    return write(fd, h, 4) == 4 && write(fd, cmd, n) == (ssize_t)n;
+}
+
+static int read_full(int fd, void *buf, size_t n) {
+    for (size_t got = 0; got < n; ) {
+        ssize_t r = read(fd, (char *)buf + got, n - got);
+        if (r <= 0) return 0;
+        got += (size_t)r;
+    }
+    return 1;
+}
+
+static int frame_recv(int fd, char *buf, size_t cap) {
+    unsigned char h[4];
+    if (!read_full(fd, h, 4)) return 0;
+    size_t n = (size_t)h[0] << 24 | (size_t)h[1] << 16 | (size_t)h[2] << 8 | h[3];
+    if (n >= cap || !read_full(fd, buf, n)) return 0;
+    buf[n] = '\0';
+    return 1;
+}
+#endif
+
+#ifdef __linux__
+typedef struct {
+    size_t slot;
+    int bad;
+} ViewReader;
+
+static void *view_reader_main(void *arg) {
+    ViewReader *r = arg;
+    for (int i = 0; i < 2000; ++i) {
+        char line[] = "GET 900";
+        Reply out = { NULL, 0, 0, 0 };
+        view_answer(r->slot, line, &out);
+        if (out.failed || out.len < 6 || strncmp(out.buf, "OK 1\n900,Ada,", 13) != 0) r->bad++;
+        free(out.buf);
+    }
+    return NULL;
+}
+#endif
+
+// view_publish / view_answer / view_reclaim (copy-on-write chunks and ID pages, epochs)
+static void t_view(void) {
+#ifdef __linux__
+    FILE *f = fopen(CSV_FILE, "w");
+    fputs("orderid,customername,productname,quantity,price,orderdate\n", f);
+    for (int i = 0; i < VIEW_CHUNK + 44; ++i)
+        fprintf(f, "%d,Ada,Part %d,1,1.00,%s\n", 900 + i, i, i == 5 ? "31-02-2024" : "05-01-2024");
+    fclose(f);
+    delete_file_if_exists(WAL_FILE);
+    RUN_SILENT(store_load());
+    store.tracking = 1;
+    CHECK_TRUE("first view", view_publish() && view_current->nchunks == 2);
+
+    char get[] = "GET 901", find[] = "FIND part 299", bad[] = "GET x", up[] = "UPDATE 901,,,7,,";
+    Reply out = { NULL, 0, 0, 0 };
+    view_answer(0, get, &out);
+    CHECK_TRUE("get from view", out.len && strncmp(out.buf, "OK 1\n901,Ada,Part 1,1,", 22) == 0);
+    out.len = 0;
+    view_answer(0, find, &out);
+    CHECK_TRUE("find from view", out.len && strncmp(out.buf, "OK 1\n1199,", 10) == 0);
+    out.len = 0;
+    CHECK_TRUE("writes are not for readers", !view_answer(0, up, &out));
+    view_answer(0, bad, &out);
+    CHECK_TRUE("reader errors match batch", out.len == 17 && strncmp(out.buf, "ERR bad order id\n", 17) == 0);
+
+    // a reader inside the old view keeps it, and its untouched chunk is shared
+    const View *held = view_enter(1);
+    RUN_SILENT(batch_answer(up, &out));
+    out.len = 0;
+    view_answer(0, get, &out);
+    CHECK_TRUE("unpublished write not visible", strncmp(out.buf, "OK 1\n901,Ada,Part 1,1,", 22) == 0);
+    view_publish();
+    CHECK_TRUE("old view kept while read", view_retired == held);
+    CHECK_TRUE("only the written chunk copied", view_current->chunks[0] != held->chunks[0]
+               && view_current->chunks[1] == held->chunks[1] && held->chunks[0]->rows[1].qty == 1);
+    view_exit(1);
+    view_reclaim();
+    CHECK_TRUE("reclaimed after the reader left", view_retired == NULL);
+    out.len = 0;
+    view_answer(0, get, &out);
+    CHECK_TRUE("published write visible", strncmp(out.buf, "OK 1\n901,Ada,Part 1,7,", 22) == 0);
+    char get_text[] = "GET 905";
+    out.len = 0;
+    view_answer(0, get_text, &out);
+    CHECK_TRUE("date text copied with the chunk", out.len > 5 && strstr(out.buf, ",31-02-2024\n"));
+
+    // the ID index is shared page by page the same way
+    char add[] = "ADD 1300,Bea,Part X,2,1.00,06-01-2024", del[] = "DELETE 902";
+    char get_new[] = "GET 1300", get_gone[] = "GET 902";
+    held = view_enter(1);
+    RUN_SILENT(batch_answer(add, &out));
+    RUN_SILENT(batch_answer(del, &out));
+    view_publish();
+    size_t pa = id_hash(1300, held->npages), pd = id_hash(902, held->npages), same = 0;
+    for (size_t p = 0; p < held->npages; ++p) same += view_current->pages[p] == held->pages[p];
+    CHECK_TRUE("only the written ID pages copied", view_current->npages == held->npages
+               && view_current->pages[pa] != held->pages[pa] && view_current->pages[pd] != held->pages[pd]
+               && same == held->npages - 1 - (pa != pd));
+    view_exit(1);
+    view_reclaim();
+    out.len = 0;
+    view_answer(0, get_new, &out);
+    CHECK_TRUE("added row found by id", strncmp(out.buf, "OK 1\n1300,Bea,Part X,2,", 23) == 0);
+    out.len = 0;
+    view_answer(0, get_gone, &out);
+    CHECK_TRUE("deleted row gone from the id index", out.len == 5 && strncmp(out.buf, "OK 0\n", 5) == 0);
+
+    // FIND: the trigram base shortlists, rows named since it was built are checked as well
+    char ren[] = "UPDATE 903,,Gizmo Nut,,,", find_new[] = "FIND gizmo", find_old[] = "FIND part 3";
+    RUN_SILENT(batch_answer(ren, &out));
+    view_publish();
+    CHECK_TRUE("added and renamed rows fresh", view_current->grams && view_current->nfresh == 2);
+    out.len = 0;
+    view_answer(0, find_new, &out);
+    CHECK_TRUE("renamed row found", strncmp(out.buf, "OK 1\n903,Ada,Gizmo Nut,", 23) == 0);
+    out.len = 0;
+    view_answer(0, find_old, &out);
+    CHECK_TRUE("old name no longer matches", strncmp(out.buf, "OK 10\n930,", 10) == 0);
+    unsigned long gen = view_current->gram_gen;
+    view_gram_slack = 0;    // past 1/8 of the rows: 40 more renames
+    for (int i = 0; i < 40; ++i) {
+        char cmd[64];
+        snprintf(cmd, sizeof cmd, "UPDATE %d,,Gizmo %d,,,", 910 + i, i);
+        RUN_SILENT(batch_answer(cmd, &out));
+    }
+    view_publish();
+    view_gram_slack = 4096;
+    CHECK_TRUE("base rebuilt", view_current->gram_gen == gen + 1 && view_current->nfresh == 0 && view_current->grams);
+    out.len = 0;
+    view_answer(0, find_new, &out);
+    CHECK_TRUE("rebuilt base finds them all", strncmp(out.buf, "OK 41\n903,Ada,Gizmo Nut,", 24) == 0
+               && strstr(out.buf, "\n949,Ada,Gizmo 39,"));
+    free(out.buf);
+
+    // readers on their own threads while the writer keeps publishing
+    ViewReader rd[2] = { { 1, 0 }, { 2, 0 } };
+    pthread_t th[2];
+    for (int i = 0; i < 2; ++i) pthread_create(&th[i], NULL, view_reader_main, &rd[i]);
+    for (int i = 0; i < 200; ++i) {
+        char cmd[64];
+        Reply w = { NULL, 0, 0, 0 };
+        snprintf(cmd, sizeof cmd, "UPDATE 900,,,%d,,", i);
+        pthread_mutex_lock(&view_writer);
+        batch_answer(cmd, &w);
+        view_publish();
+        pthread_mutex_unlock(&view_writer);
+        free(w.buf);
+    }
+    for (int i = 0; i < 2; ++i) pthread_join(th[i], NULL);
+    CHECK_TRUE("concurrent readers saw whole rows", rd[0].bad == 0 && rd[1].bad == 0);
+    view_drop();
+    CHECK_TRUE("dropped", view_current == NULL && view_retired == NULL && !store.tracking);
+#else
+    CHECK_TRUE("views are daemon-only", 1);
+#endif
+}
+
+static void t_serve(void) {
+#ifdef __linux__
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "800,Ada,Hex Bolt,1,1.00,05-01-2024\n");
+    remove("ut.sock");
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        mute_outputs_begin();
+        serve_threads = 3;
+        _exit(serve("ut.sock") ? 0 : 1);
+    }
+
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, "ut.sock");
+    int fd = -1;
+    for (int tries = 0; tries < 200 && fd < 0; ++tries) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr *)&sa, sizeof sa) != 0) { close(fd); fd = -1; usleep(10000); }
+    }
+    CHECK_TRUE("daemon accepts", fd >= 0);
+
+    char buf[512] = "";
+    int ok = fd >= 0 && frame_send(fd, "GET 800") && frame_recv(fd, buf, sizeof buf);
+    CHECK_EQ_STR("get over socket", "OK 1\n800,Ada,Hex Bolt,1,1.00,05-01-2024\n", ok ? buf : "");
+
+    char a[512] = "", b[512] = "", g[512] = "";
+    ok = fd >= 0 && frame_send(fd, "ADD 801,Bea,Nut,2,0.50,01-01-2024") && frame_send(fd, "GET 801") &&
+         frame_send(fd, "FROB") && frame_recv(fd, a, sizeof a) && frame_recv(fd, g, sizeof g) && frame_recv(fd, b, sizeof b);
+    CHECK_TRUE("pipelined frames answered in order",
+               ok && strcmp(a, "OK 1\n801,Bea,Nut,2,0.50,01-01-2024\n") == 0 && strcmp(b, "ERR unknown command\n") == 0);
+    CHECK_EQ_STR("read sees the write before it", "OK 1\n801,Bea,Nut,2,0.50,01-01-2024\n", g);
+
+    // a burst written in one go comes back as one answer per frame, in order
+    char burst[300 * 12];
+    size_t blen = 0;
+    for (int i = 0; i < 300; ++i) {
+        int n = i % 2 ? 7 : 8;  // "GET 800" or "GET 9999"
+        burst[blen++] = 0; burst[blen++] = 0; burst[blen++] = 0; burst[blen++] = (char)n;
+        memcpy(burst + blen, i % 2 ? "GET 800" : "GET 9999", (size_t)n);
+        blen += (size_t)n;
+    }
+    ok = fd >= 0 && write(fd, burst, blen) == (ssize_t)blen;
+    for (int i = 0; ok && i < 300; ++i)
+        ok = frame_recv(fd, buf, sizeof buf) && strncmp(buf, i % 2 ? "OK 1\n" : "OK 0\n", 5) == 0;
+    CHECK_TRUE("burst of 300 frames answered in order", ok);
+    if (fd >= 0) close(fd);
+
+    int status = -1;
+    kill(pid, SIGTERM);
+    waitpid(pid, &status, 0);
+    CHECK_TRUE("daemon stops cleanly", WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    RUN_SILENT(store_load());
+    CHECK_TRUE("daemon's add persisted", orderIDExists(801));
+#else
+    int ok;
+    RUN_SILENT(ok = serve("ut.sock"));
+    CHECK_TRUE("daemon unsupported here", !ok);
+#endif
+}
+
+// rows among the slots dates_range returned that are not deleted
+static size_t live_slots(size_t first, size_t n) {
+    size_t live = 0;
+    for (size_t i = first; i < first + n; ++i) live += !store_dead(store.dates.pos[i]);
+    return live;
+}
+
+// dates_build / dates_range + searchByDateRange (index follows add/update/delete)
+static void t_date_range(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "310,Ada,Box,1,1.00,05-01-2024\n"
+        "311,Bea,Bag,1,1.00,01-01-2024\n"
+        "312,Cy,Cap,1,1.00,03-01-2024\n"
+        "313,Di,Cog,1,1.00,03-01-2024\n");
+    set_stdin_from_string("02-01-2024\n04-01-2024\n");
+    RUN_SILENT(searchByDateRange());
+    CHECK_TRUE("built on first query", store.dates.built);
+
+    size_t first, n = dates_range(20240102, 20240104, &first);
+    CHECK_EQ_INT("range count", 2, (int)n);
+    CHECK_TRUE("date then file order", n == 2 && store.dates.pos[first] == 2 && store.dates.pos[first+1] == 3);
+
+    set_stdin_from_string("314\nEd\nDie\n1\n1.00\n02-01-2024\n");
+    RUN_SILENT(Addcsv());
+    set_stdin_from_string("312\n\n\n\n\n10-01-2024\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("313\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    n = dates_range(20240102, 20240104, &first);
+    CHECK_TRUE("kept in step", live_slots(first, n) == 1 && store.dates.pos[first] == 4);
+    n = dates_range(20240101, 20241231, &first);
+    CHECK_EQ_INT("all live", 4, (int)live_slots(first, n));
+}
+
+// searchMenu (go in and immediately back out; date range is [4], after Back)
+static void t_searchMenu(void) {
+    set_stdin_from_string("3\n");
+    RUN_SILENT(searchMenu());
+    dates_reset();
+    set_stdin_from_string("4\n01-01-2024\n31-12-2024\n3\n");
+    RUN_SILENT(searchMenu());
+    CHECK_TRUE("date range reached from the menu", store.dates.built);
+}
+
+// updateOrderByID (change just product; others blank)
+static void t_updateOrderByID(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "400,Fay,Item,5,10.00,06-01-2024\n");
+    set_stdin_from_string(
+        "400\n"     // id to update
+        "\n"        // keep customer
+        "NewItem\n" // new product
+        "\n"        // keep qty
+        "\n"        // keep price
+        "\n"        // keep date
+    );
+    RUN_SILENT(updateOrderByID());
+    RUN_SILENT(store_checkpoint());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("product changed", s && strstr(s, "400,Fay,NewItem,5,10.00,06-01-2024")!=NULL);
+    if (s) free(s);
+}
+
+// deleteByOrderID (two matches; choose 1; confirm Y)
+static void t_deleteByOrderID(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "500,Ann,AAA,1,1.00,01-02-2024\n"
+        "500,Ben,BBB,2,2.00,02-02-2024\n"
+        "501,Cid,CCC,3,3.00,03-02-2024\n");
+    set_stdin_from_string("500\n1\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    RUN_SILENT(store_checkpoint());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("deleted one of 500", s && strstr(s,"500,Ann,AAA,1,1.00,01-02-2024")==NULL);
+    CHECK_TRUE("still has other 500", s && strstr(s,"500,Ben,BBB,2,2.00,02-02-2024")!=NULL);
+    CHECK_TRUE("kept 501", s && strstr(s,"501,Cid,CCC,3,3.00,03-02-2024")!=NULL);
+    if (s) free(s);
+
+    // more matches than any fixed buffer; the last one is a bit, not a rewrite
+    size_t cap = 64 + 1100 * 40, len = 0;
+    char* csv = malloc(cap);
+    len += (size_t)snprintf(csv + len, cap - len, "orderid,customername,productname,quantity,price,orderdate\n");
+    for (int i = 0; i < 1100; ++i)
+        len += (size_t)snprintf(csv + len, cap - len, "502,Dee,Lamp %d,1,1.00,04-02-2024\n", i);
+    write_csv_fixture(csv);
+    free(csv);
+    RUN_SILENT(dates_build());
+    RUN_SILENT(grams_build());
+    set_stdin_from_string("502\n1100\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    size_t* hits;
+    size_t n = idx_matches(&store.ids, 502, &hits);
+    free(hits);
+    CHECK_TRUE("1100th match deleted", n == 1099 && store_dead(1099) && !store_dead(1098) && store.ndeleted == 1);
+    uint32_t* c;
+    n = grams_candidates("lamp 1099", &c);
+    free(c);
+    size_t first, slots = dates_range(20240204, 20240204, &first);
+    CHECK_TRUE("indexes skip it", n == 0 && slots == 1100 && live_slots(first, slots) == 1099);
+    char* wal = read_whole_file(WAL_FILE);
+    CHECK_TRUE("logged, csv not rewritten", wal && strcmp(wal, "D,1099\n") == 0);
+    if (wal) free(wal);
+}
+
+// wal_append_* + replay on load + checkpoint folding the log into the CSV
+static void t_wal_replay(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "800,Ned,Cup,1,3.00,01-03-2024\n"
+        "801,Oli,Pan,2,15.00,02-03-2024\n");
+    set_stdin_from_string("801\n\nWok\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("800\nY\n");
+    RUN_SILENT(deleteByOrderID());
+
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("csv untouched", s && strstr(s, "801,Oli,Pan,2,15.00,02-03-2024")!=NULL);
+    if (s) free(s);
+    s = read_whole_file(WAL_FILE);
+    CHECK_TRUE("update logged", s && strstr(s, "U,1,801,Oli,Wok,2,15.00,02-03-2024\n")!=NULL);
+    CHECK_TRUE("delete logged", s && strstr(s, "D,0\n")!=NULL);
+    if (s) free(s);
+
+    RUN_SILENT(store_load());
+    CHECK_TRUE("800 gone after replay", !orderIDExists(800));
+    CHECK_EQ_STR("801 updated after replay", "Wok", store.rows[idx_first(&store.ids, 801)].product);
+
+    // torn tail is ignored
+    FILE* f = fopen(WAL_FILE, "a");
+    fputs("U,1,801,Oli,Po", f);
+    fclose(f);
+    RUN_SILENT(store_load());
+    CHECK_EQ_STR("torn record ignored", "Wok", store.rows[idx_first(&store.ids, 801)].product);
+    s = read_whole_file(WAL_FILE);
+    CHECK_TRUE("torn tail cut on load", s && strcmp(s, "U,1,801,Oli,Wok,2,15.00,02-03-2024\nD,0\n")==0);
+    if (s) free(s);
+
+    // a delete torn before its newline deletes nothing
+    f = fopen(WAL_FILE, "a");
+    fputs("D,1", f);
+    fclose(f);
+    RUN_SILENT(store_load());
+    CHECK_TRUE("torn delete ignored", orderIDExists(801));
+
+    // an edit acknowledged after a crash left a torn tail survives a reload
+    f = fopen(WAL_FILE, "a");
+    fputs("U,1,801,Oli,Po", f);
+    fclose(f);
+    set_stdin_from_string("801\n\nPot\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    RUN_SILENT(store_load());
+    CHECK_EQ_STR("edit after torn tail kept", "Pot", store.rows[idx_first(&store.ids, 801)].product);
+    set_stdin_from_string("801\n\nWok\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+
+    RUN_SILENT(store_checkpoint());
+    s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("checkpoint wrote csv", s && strcmp(s,
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "801,Oli,Wok,2,15.00,02-03-2024\n")==0);
+    if (s) free(s);
+    CHECK_TRUE("log dropped", read_whole_file(WAL_FILE) == NULL);
+}
+
+// checkpoint_recover (both sides of an interrupted swap)
+static void t_checkpoint_recover(void) {
+    const char* hdr = "orderid,customername,productname,quantity,price,orderdate\n";
+    // crash before the CSV was replaced: old log comes back, tmp is dropped
+    write_csv_fixture(hdr);
+    write_text_file(WAL_FILE ".old", "D,0\n");
+    write_text_file("orders.tmp", "partial");
+    RUN_SILENT(checkpoint_recover());
+    char* s = read_whole_file(WAL_FILE);
+    CHECK_TRUE("log restored", s && strcmp(s, "D,0\n")==0);
+    if (s) free(s);
+    CHECK_TRUE("tmp dropped", read_whole_file("orders.tmp") == NULL);
+
+    // crash after the CSV was removed: finish the rename, forget the old log
+    delete_file_if_exists(WAL_FILE);
+    write_text_file(WAL_FILE ".old", "D,0\n");
+    write_text_file("orders.tmp", hdr);
+    remove(CSV_FILE);
+    RUN_SILENT(checkpoint_recover());
+    s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("csv restored", s && strcmp(s, hdr)==0);
+    if (s) free(s);
+    CHECK_TRUE("old log gone", read_whole_file(WAL_FILE ".old") == NULL);
+}
+
+// compact_start / compact_wait (edits made while compacting are carried over)
+static void t_compaction(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "900,Pia,Fan,1,20.00,01-04-2024\n"
+        "901,Quin,Rug,1,60.00,02-04-2024\n"
+        "902,Rex,Mug,3,4.00,03-04-2024\n"
+        "903,Sam,Pot,1,9.00,04-04-2024\n");
+    set_stdin_from_string("900\nY\n");
+    RUN_SILENT(deleteByOrderID());
+    set_stdin_from_string("902\n\nCup\n\n\n\n");
+    RUN_SILENT(updateOrderByID());
+
+    int started;
+    RUN_SILENT(started = compact_start());
+    CHECK_TRUE("compaction started", started);
+
+    // edits racing the background merge
+    set_stdin_from_string("904\nTia\nVase\n2\n11.00\n05-04-2024\n");
+    RUN_SILENT(Addcsv());
+    set_stdin_from_string("903\n\n\n5\n\n\n");
+    RUN_SILENT(updateOrderByID());
+    set_stdin_from_string("901\nY\n");
+    RUN_SILENT(deleteByOrderID());
+
+    RUN_SILENT(compact_wait());
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("snapshot merged", s && strcmp(s,
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "901,Quin,Rug,1,60.00,02-04-2024\n"
+        "902,Rex,Cup,3,4.00,03-04-2024\n"
+        "903,Sam,Pot,1,9.00,04-04-2024\n"
+        "904,Tia,Vase,2,11.00,05-04-2024\n")==0);
+    if (s) free(s);
+    s = read_whole_file(WAL_FILE);
+    CHECK_TRUE("log renumbered", s && strcmp(s, "U,2,903,Sam,Pot,5,9.00,04-04-2024\nD,0\n")==0);
+    if (s) free(s);
+
+    CHECK_TRUE("memory renumbered", !orderIDExists(901) && idx_first(&store.ids, 903) == 2);
+    CHECK_TRUE("tombstones renumbered", store_dead(0) && !store_dead(1) && !store_dead(2) && !store_dead(3)
+               && store.ndeleted == 1);
+    RUN_SILENT(store_load());
+    CHECK_TRUE("reload agrees", !orderIDExists(900) && !orderIDExists(901)
+               && store.rows[idx_first(&store.ids, 903)].qty == 5
+               && idx_first(&store.ids, 904) == 3);
+}
+
+// store_sync / order_locate (another process wrote the files meanwhile)
+static void t_store_sync(void) {
+    write_csv_fixture(
+        "orderid,customername,productname,quantity,price,orderdate\n"
+        "950,Uma,Cap,1,5.00,01-05-2024\n"
+        "951,Vic,Hat,2,7.00,02-05-2024\n");
+    unsigned long loads = store.loads;
+    Order seen = store.rows[1];
+
+    // appends by someone else are read from where we stopped
+    FILE* f = fopen(CSV_FILE, "a");
+    if (f) { fputs("952,Wes,Bag,1,30.00,03-05-2024\n", f); fclose(f); }
+    f = fopen(WAL_FILE, "a");
+    if (f) { fputs("U,0,950,Uma,Cap,9,5.00,01-05-2024\nD,1\n", f); fclose(f); }
+    int ok;
+    RUN_SILENT(ok = store_ensure_loaded());
+    CHECK_TRUE("appends picked up", ok && orderIDExists(952) && !orderIDExists(951)
+               && store.rows[idx_first(&store.ids, 950)].qty == 9);
+    CHECK_EQ_INT("no full reload", (int)loads, (int)store.loads);
+    CHECK_TRUE("deleted row is stale", order_locate(1, &seen) == ID_EMPTY);
+
+    // a swap elsewhere renumbers rows: read everything again
+    RUN_SILENT(store_lock(LK_EXCL));
+    lock_gen_bump();
+    store_unlock();
+    seen = store.rows[idx_first(&store.ids, 952)];
+    RUN_SILENT(ok = store_refresh());
+    CHECK_TRUE("swap reloads", ok && store.loads == loads + 1);
+    CHECK_TRUE("row found again", order_locate(0, &seen) == 2);
+
+#ifdef __linux__
+    // fcntl locks are per process: a child cannot share while we write
+    RUN_SILENT(store_lock(LK_EXCL));
+    pid_t pid = fork();
+    if (pid == 0) _exit(lock_range(LK_SHARED, LOCK_DATA, 0) ? 1 : 0);
+    int status = -1;
+    waitpid(pid, &status, 0);
+    store_unlock();
+    CHECK_TRUE("exclusive lock keeps others out", WIFEXITED(status) && WEXITSTATUS(status) == 0);
+#endif
+}
+
+static unsigned long syncs_now(void) {
+#ifndef _WIN32
+    pthread_mutex_lock(&commit_lock);
+    unsigned long n = commit.syncs;
+    pthread_mutex_unlock(&commit_lock);
+    return n;
+#else
+    return commit.syncs;
+#endif
+}
+
+// commit_parse_mode / commit_flush / commit_close (appends per write section, syncs per mode)
+static void t_commit(void) {
+    CHECK_TRUE("parse group", commit_parse_mode("group,2,60000") && commit.mode == DURABLE_GROUP
+               && commit.group_ops == 2 && commit.group_ms == 60000);
+    CHECK_TRUE("parse rejects", !commit_parse_mode("fast") && !commit_parse_mode("group,0"));
+    write_csv_fixture("orderid,customername,productname,quantity,price,orderdate\n");
+
+    // one write per section, however many rows it holds
+    Reply out = { NULL, 0, 0, 0 };
+    char a[] = "ADD 960,Ann,Cup,1,2.00,01-06-2024", b[] = "ADD 961,Ben,Cup,1,2.00,01-06-2024";
+    unsigned long writes = commit.writes, syncs = syncs_now();
+    RUN_SILENT(store_write_begin());
+    RUN_SILENT(batch_answer(a, &out));
+    RUN_SILENT(batch_answer(b, &out));
+    char* s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("held until the section ends", s && !strstr(s, "960,"));
+    if (s) free(s);
+    int ok;
+    RUN_SILENT(ok = store_write_end());
+    s = read_whole_file(CSV_FILE);
+    CHECK_TRUE("section written at once", ok && commit.writes == writes + 1 && s && strstr(s, "961,"));
+    if (s) free(s);
+
+    // group of 2 (the window is far off): the second section syncs both
+    CHECK_TRUE("first of group pending", syncs_now() == syncs && commit.dirty == COMMIT_CSV);
+    char c[] = "DELETE 960", d[] = "DELETE 961";
+    RUN_SILENT(batch_answer(c, &out));
+    CHECK_TRUE("group synced", syncs_now() == syncs + 1 && !commit.dirty);
+    RUN_SILENT(batch_answer(d, &out));
+    RUN_SILENT(commit_close());
+    CHECK_TRUE("close syncs the rest", syncs_now() == syncs + 2 && !commit.dirty);
+
+#ifndef _WIN32
+    // a lone section is synced by the flusher within the window
+    commit_parse_mode("group,100,20");
+    char e[] = "ADD 962,Cid,Cup,1,2.00,01-06-2024";
+    syncs = syncs_now();
+    RUN_SILENT(batch_answer(e, &out));
+    for (int i = 0; i < 100 && syncs_now() == syncs; ++i) usleep(5000);
+    CHECK_TRUE("window synced", syncs_now() == syncs + 1);
+    RUN_SILENT(commit_close());
+#endif
+
+    commit_parse_mode("op");
+    char f[] = "ADD 963,Dee,Cup,1,2.00,01-06-2024";
+    syncs = syncs_now();
+    RUN_SILENT(batch_answer(f, &out));
+    CHECK_TRUE("op syncs each", syncs_now() == syncs + 1);
+    RUN_SILENT(commit_close());
+    commit_parse_mode("none");
+    free(out.buf);
+}
+
+static void t_stats(void) {
+    // exact below 16 ns, then within 1/16 of the value
+    CHECK_TRUE("bucket exact", stat_bucket(7) == 7 && stat_bucket_top(7) == 7);
+    unsigned b = stat_bucket(1000);
+    CHECK_TRUE("bucket bounds", stat_bucket_top(b) >= 1000 && stat_bucket_top(b) < 1000 + 1000 / 16
+               && stat_bucket(stat_bucket_top(b) + 1) == b + 1);
+
+    StatHist saved = stat_ops[OP_RANGE];
+    memset(&stat_ops[OP_RANGE], 0, sizeof saved);
+    for (uint64_t ns = 1; ns <= 100; ++ns) stat_record(OP_RANGE, ns * 1000);
+    uint64_t p50 = stat_percentile(&stat_ops[OP_RANGE], 0.50), p99 = stat_percentile(&stat_ops[OP_RANGE], 0.99);
+    CHECK_TRUE("percentiles", p50 >= 50000 && p50 < 50000 + 50000 / 16 && p99 >= 99000 && p99 <= 100000);
+    CHECK_TRUE("max", stat_percentile(&stat_ops[OP_RANGE], 1.0) == 100000);
+    stat_ops[OP_RANGE] = saved;
+
+    write_csv_fixture("orderid,customername,productname,quantity,price,orderdate\n"
+                      "970,Ann,Cup,1,2.00,01-06-2024\n");
+    Reply out = { NULL, 0, 0, 0 };
+    char get[] = "GET 970";
+    uint64_t gets = stat_ops[OP_GET].count, matched = stat_counters[CT_ROWS_MATCHED];
+    RUN_SILENT(batch_answer(get, &out));
+    CHECK_TRUE("batch GET counted", stat_ops[OP_GET].count == gets + 1
+               && stat_counters[CT_ROWS_MATCHED] == matched + 1);
+    free(out.buf);
+
+    FILE* f = tmpfile();
+    char row[64] = "";
+    if (f) {
+        stats_print(f);
+        rewind(f);
+        while (fgets(row, sizeof row, f) && strncmp(row, "get ", 4) != 0) {}
+        fclose(f);
+    }
+    CHECK_TRUE("table has get", strncmp(row, "get ", 4) == 0);
+
+    const char* path = "ut_stats.json";
+    stats_json_path = path;
+    stats_dump();
+    stats_json_path = NULL;
+    char* s = read_whole_file(path);
+    CHECK_TRUE("json keys", s && strstr(s, "\"ops\"") && strstr(s, "\"get\": {\"count\": ")
+               && strstr(s, "\"counters\"") && strstr(s, "\"rows_matched\": "));
+    if (s) free(s);
+    remove(path);
+}
+
+#ifndef _WIN32
+static void* trace_thread_main(void* arg) {
+    for (int i = 0; i < TRACE_RING + 5; ++i) {
+        TRACE_BEGIN(tr);
+        TRACE_END(tr, "spin");
+    }
+    return arg;
+}
+#endif
+
+static void t_trace(void) {
+    // off: nothing is recorded
+    TRACE_BEGIN(off);
+    TRACE_END(off, "never");
+    CHECK_TRUE("off records nothing", off == 0 && trace_rings == NULL);
+
+    const char* path = "ut_trace.json";
+    trace_start(path);
+    write_csv_fixture("orderid,customername,productname,quantity,price,orderdate\n"
+                      "980,Ann,Cup,1,2.00,01-06-2024\n");
+    Reply out = { NULL, 0, 0, 0 };
+    char find[] = "FIND cup";
+    RUN_SILENT(batch_answer(find, &out));
+    free(out.buf);
+    CHECK_TRUE("spans recorded", trace_mine && trace_mine->n >= 2
+               && strcmp(trace_mine->ev[(trace_mine->n - 1) % TRACE_RING].name, "find") == 0);
+
+#ifndef _WIN32
+    // a thread gets its own ring, which keeps the newest spans
+    pthread_t t;
+    int joined = pthread_create(&t, NULL, trace_thread_main, NULL) == 0 && pthread_join(t, NULL) == 0;
+    CHECK_TRUE("own ring", joined && trace_rings != trace_mine && trace_rings->tid != trace_mine->tid
+               && trace_rings->n == TRACE_RING + 5);
+#endif
+
+    RUN_SILENT(trace_dump());
+    trace_on = 0;
+    char* s = read_whole_file(path);
+    CHECK_TRUE("chrome trace json", s && strncmp(s, "{\"traceEvents\": [", 17) == 0
+               && strstr(s, "\"name\": \"match\", \"cat\": \"orders\", \"ph\": \"X\"")
+               && strstr(s, "\"name\": \"find\"") && strstr(s, "\"displayTimeUnit\""));
+    if (s) free(s);
+    remove(path);
+}
+
+// ------------------- runner ----------------------------------------------
+int main(void) {
+    // string & parsing
+    t_chomp();
+    t_sanitize_commas();
+    t_lowercase();
+    t_line_starts_with_digit();
+    t_parse_csv_line();
+    t_csv_tokenize();
+    t_is_valid_date_str();
+    t_date_pack();
+
+    // input helpers
+    t_read_line();
+    t_try_parse_int();
+    t_try_parse_float();
+    t_read_int_loop();
+    t_read_float_loop();
+    t_read_text_loop();
+    t_read_optional_int();
+    t_read_optional_float();
+    t_read_optional_text();
+    t_read_date_loop();
+    t_read_optional_date();
+    t_read_menu_choice();
+
+    // CSV + features
+    t_ensure_and_exists();
+    t_line_reader();
+    t_store_load_save();
+    t_store_bad_dates();
+    t_id_index();
+    t_idx_file_lookup();
+    t_Addcsv();
+    t_searchByOrderID();
+    t_searchByProductName();
+    t_gram_index();
+    t_fold_scan();
+    t_scan_parallel();
+    t_import_csv();
+    t_batch_run();
+    t_view();
+    t_serve();
+    t_date_range();
+    t_searchMenu();
+    t_updateOrderByID();
+    t_deleteByOrderID();
+    t_wal_replay();
+    t_checkpoint_recover();
+    t_compaction();
+    t_store_sync();
+    t_commit();
+    t_stats();
+    t_trace();
+
+    printf("\nTests run: %d, failed: %d\n", tests_run, tests_failed);
+    if (tests_failed == 0) {
+        printf("[OK] All tests passed.\n");
+        return 0;
+    } else {
+        printf("[X] Some tests failed.\n");
+        return 1;
+    }
+}
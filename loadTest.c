@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Load generator for daemon mode: starts `--serve` on its own CSV, runs
+// several client threads against it, checks every reply, then reports
+// throughput and latency percentiles. A second phase sends the same GETs
+// over one connection, first one round trip each and then pipelined
+// PIPE_DEPTH at a time, and prints both rates.
+// Build: gcc loadTest.c -o loadTest -pthread
+
+#ifdef __linux__
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define APP_EXE    "./orders_app_load"
+#define CLIENT_EXE "./order_client"
+#define BUILD_APP  "gcc -std=c99 -O2 -DCSV_FILE=\\\"Loadtestorders.csv\\\" Ordermanager.c -o orders_app_load -pthread"
+#define BUILD_CLI  "gcc -std=c99 -O2 OrderClient.c -o order_client"
+#define CSV        "Loadtestorders.csv"
+#define SOCK       "Loadtestorders.csv.sock"
+
+#define CLIENTS    8
+#define PER_CLIENT 2500     // ADD + GET each, plus a FIND every 50
+#define PIPE_GETS  20000
+#define PIPE_DEPTH 64
+
+typedef struct {
+    int id;
+    double *lat;            // seconds per request
+    size_t nlat;
+    int bad;
+} Client;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int file_exists(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f) { fclose(f); return 1; }
+    return 0;
+}
+
+static int connect_sock(void) {
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, SOCK);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof sa) == 0) return fd;
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+static int io_full(int fd, void *buf, size_t n, int out) {
+    for (size_t done = 0; done < n; ) {
+        ssize_t r = out ? write(fd, (char *)buf + done, n - done) : read(fd, (char *)buf + done, n - done);
+        if (r <= 0) return 0;
+        done += (size_t)r;
+    }
+    return 1;
+}
+
+// one framed round trip; reply NUL-terminated into buf
+static int call(int fd, const char *cmd, char *buf, size_t cap) {
+    size_t n = strlen(cmd);
+    unsigned char h[4] = { (unsigned char)(n >> 24), (unsigned char)(n >> 16), (unsigned char)(n >> 8), (unsigned char)n };
+    if (!io_full(fd, h, 4, 1) || !io_full(fd, (void *)cmd, n, 1) || !io_full(fd, h, 4, 0)) return 0;
+    size_t len = (size_t)h[0] << 24 | (size_t)h[1] << 16 | (size_t)h[2] << 8 | h[3];
+    if (len >= cap || !io_full(fd, buf, len, 0)) return 0;
+    buf[len] = '\0';
+    return 1;
+}
+
+static int read_reply(int fd, char *buf, size_t cap) {
+    unsigned char h[4];
+    if (!io_full(fd, h, 4, 0)) return 0;
+    size_t len = (size_t)h[0] << 24 | (size_t)h[1] << 16 | (size_t)h[2] << 8 | h[3];
+    if (len >= cap || !io_full(fd, buf, len, 0)) return 0;
+    buf[len] = '\0';
+    return 1;
+}
+
+// GET every id from base on, depth requests per writev; returns requests/s, 0 on a bad reply
+static double get_rate(int fd, int base, int count, int depth) {
+    char cmd[PIPE_DEPTH][32], reply[4096];
+    unsigned char hdr[PIPE_DEPTH][4];
+    struct iovec iov[2 * PIPE_DEPTH];
+    double t = now();
+    for (int done = 0; done < count; ) {
+        int n = count - done < depth ? count - done : depth;
+        for (int i = 0; i < n; ++i) {
+            size_t len = (size_t)snprintf(cmd[i], sizeof cmd[i], "GET %d", base + done + i);
+            hdr[i][0] = hdr[i][1] = hdr[i][2] = 0;
+            hdr[i][3] = (unsigned char)len;
+            iov[2 * i].iov_base = hdr[i];
+            iov[2 * i].iov_len = 4;
+            iov[2 * i + 1].iov_base = cmd[i];
+            iov[2 * i + 1].iov_len = len;
+        }
+        // a window is well under the socket buffer, so one writev takes it all
+        ssize_t want = 0;
+        for (int i = 0; i < 2 * n; ++i) want += (ssize_t)iov[i].iov_len;
+        if (writev(fd, iov, 2 * n) != want) return 0;
+        for (int i = 0; i < n; ++i)
+            if (!read_reply(fd, reply, sizeof reply) || strncmp(reply, "OK 1\n", 5) != 0) return 0;
+        done += n;
+    }
+    return count / (now() - t);
+}
+
+static void *client_main(void *arg) {
+    Client *c = arg;
+    char cmd[256];
+    size_t cap = 1 << 20;
+    char *reply = malloc(cap);
+    int fd = reply ? connect_sock() : -1;
+    if (fd < 0) { c->bad++; free(reply); return NULL; }
+    for (int i = 0; i < PER_CLIENT; ++i) {
+        int id = 1000000 + c->id * PER_CLIENT + i;
+        double t;
+
+        snprintf(cmd, sizeof cmd, "ADD %d,Client%d,Part %d,%d,%d.25,%02d-%02d-2024", id, c->id, i % 97, 1 + i % 9, i % 50, 1 + i % 28, 1 + i % 12);
+        t = now();
+        if (!call(fd, cmd, reply, cap) || strncmp(reply, "OK 1\n", 5) != 0) c->bad++;
+        c->lat[c->nlat++] = now() - t;
+
+        snprintf(cmd, sizeof cmd, "GET %d", id);
+        t = now();
+        if (!call(fd, cmd, reply, cap) || strncmp(reply, "OK 1\n", 5) != 0) c->bad++;
+        c->lat[c->nlat++] = now() - t;
+
+        if (i % 50 == 0) {
+            t = now();
+            if (!call(fd, "FIND part 42", reply, cap) || strncmp(reply, "OK ", 3) != 0) c->bad++;
+            c->lat[c->nlat++] = now() - t;
+        }
+    }
+    close(fd);
+    free(reply);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(void) {
+    // Clean slate
+    remove(CSV);
+    remove(CSV ".wal");
+    remove(SOCK);
+    remove("load_out.txt");
+
+    // Build binaries if missing
+    if (!file_exists(APP_EXE) && (system(BUILD_APP) != 0 || !file_exists(APP_EXE))) {
+        printf("[LOAD] FAIL: app build failed. Is gcc in PATH?\n");
+        return 1;
+    }
+    if (!file_exists(CLIENT_EXE) && (system(BUILD_CLI) != 0 || !file_exists(CLIENT_EXE))) {
+        printf("[LOAD] FAIL: client build failed.\n");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); return 1; }
+    if (pid == 0) {
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execl(APP_EXE, APP_EXE, "--serve", (char *)NULL);
+        _exit(127);
+    }
+    int fd = -1;
+    struct timespec wait = { 0, 10 * 1000000L };
+    for (int tries = 0; tries < 500 && fd < 0; ++tries) {
+        fd = connect_sock();
+        if (fd < 0) nanosleep(&wait, NULL);
+    }
+    if (fd < 0) {
+        printf("[LOAD] FAIL: daemon did not come up on %s\n", SOCK);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return 1;
+    }
+    close(fd);
+
+    // Clients in parallel, one connection each
+    Client cl[CLIENTS];
+    pthread_t th[CLIENTS];
+    size_t per = PER_CLIENT * 2 + PER_CLIENT / 50 + 1;
+    double t0 = now();
+    for (int i = 0; i < CLIENTS; ++i) {
+        cl[i].id = i;
+        cl[i].lat = malloc(per * sizeof *cl[i].lat);
+        cl[i].nlat = 0;
+        cl[i].bad = 0;
+        pthread_create(&th[i], NULL, client_main, &cl[i]);
+    }
+    for (int i = 0; i < CLIENTS; ++i) pthread_join(th[i], NULL);
+    double secs = now() - t0;
+
+    int fails = 0, bad = 0;
+    size_t total = 0;
+    double *all = malloc(per * CLIENTS * sizeof *all);
+    for (int i = 0; i < CLIENTS; ++i) {
+        memcpy(all + total, cl[i].lat, cl[i].nlat * sizeof *all);
+        total += cl[i].nlat;
+        bad += cl[i].bad;
+        free(cl[i].lat);
+    }
+    if (bad) { printf("[LOAD] FAIL: %d request(s) got a wrong or missing reply.\n", bad); fails++; }
+
+    // Round trip per request vs pipelined, same GETs on one connection
+    fd = connect_sock();
+    double serial = fd >= 0 ? get_rate(fd, 1000000, PIPE_GETS, 1) : 0;
+    double piped = fd >= 0 ? get_rate(fd, 1000000, PIPE_GETS, PIPE_DEPTH) : 0;
+    if (fd >= 0) close(fd);
+    if (serial > 0 && piped > 0) {
+        printf("[LOAD] %d GETs on one connection: %.0f req/s one at a time, %.0f req/s pipelined x%d (%.1fx)\n",
+               PIPE_GETS, serial, piped, PIPE_DEPTH, piped / serial);
+    } else {
+        printf("[LOAD] FAIL: pipelined GETs got a wrong or missing reply.\n"); fails++;
+    }
+
+    // The shipped client against the same daemon
+    if (system(CLIENT_EXE " -s " SOCK " GET 1000000 > load_out.txt") != 0) {
+        printf("[LOAD] FAIL: order_client GET did not succeed.\n"); fails++;
+    }
+
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("[LOAD] FAIL: daemon did not stop cleanly.\n"); fails++;
+    }
+
+    // Every ADD reached the CSV
+    FILE *f = fopen(CSV, "r");
+    long lines = 0;
+    int ch;
+    if (f) { while ((ch = fgetc(f)) != EOF) lines += ch == '\n'; fclose(f); }
+    if (lines != 1 + (long)CLIENTS * PER_CLIENT) {
+        printf("[LOAD] FAIL: expected %d rows in %s, found %ld.\n", CLIENTS * PER_CLIENT, CSV, lines - 1); fails++;
+    }
+
+    qsort(all, total, sizeof *all, cmp_double);
+    printf("[LOAD] %lu requests from %d clients in %.2f s: %.0f req/s, p50 %.0f us, p99 %.0f us\n",
+           (unsigned long)total, CLIENTS, secs, total / secs,
+           total ? all[total / 2] * 1e6 : 0.0, total ? all[total * 99 / 100] * 1e6 : 0.0);
+    free(all);
+
+    if (fails == 0) {
+        printf("[LOAD] PASS: daemon served every client.\n");
+        return 0;
+    }
+    printf("[LOAD] DONE with %d failure(s).\n", fails);
+    return 1;
+}
+#else
+int main(void) {
+    printf("[LOAD] SKIP: daemon mode needs Linux.\n");
+    return 0;
+}
+#endif
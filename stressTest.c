@@ -0,0 +1,230 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Multi-process write stress: several `--batch` processes edit the same CSV
+// at once while another one keeps checkpointing it. Each writer adds its own
+// orders, deletes some of them again and updates one column of a shared set
+// of rows; afterwards no add, delete or update may be missing. Prints write
+// throughput for one process alone and for all of them together.
+// Build: gcc stressTest.c -o stressTest
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define APP_EXE    "./orders_app_stress"
+#define BUILD_APP  "gcc -std=c99 -O2 -DCSV_FILE=\\\"Stresstestorders.csv\\\" Ordermanager.c -o orders_app_stress -pthread"
+#define CSV        "Stresstestorders.csv"
+
+#define WRITERS     4       // one per updatable column: customer, product, qty, price
+#define PER_WRITER  2000    // ADDs each, plus an UPDATE every 4th and a DELETE every 10th
+#define SHARED      16      // rows 1..SHARED every writer updates
+#define CHECKPOINTS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int file_exists(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f) { fclose(f); return 1; }
+    return 0;
+}
+
+static int writer_id(int w, int k) { return 100000 * (w + 1) + k; }
+
+static int deleted(int k) { return k % 10 == 9; }  // step k deletes the row added at k - 5
+
+static void fresh_csv(void) {
+    remove(CSV);
+    remove(CSV ".wal");
+    FILE* f = fopen(CSV, "w");
+    if (!f) return;
+    fputs("orderid,customername,productname,quantity,price,orderdate\n", f);
+    for (int j = 1; j <= SHARED; ++j) fprintf(f, "%d,Shared,Item,1,1.00,01-01-2024\n", j);
+    fclose(f);
+}
+
+// the commands of writer w; returns how many writes it holds
+static long write_script(int w, const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    long n = 0;
+    for (int k = 0; k < PER_WRITER; ++k) {
+        fprintf(f, "ADD %d,W%d,Item%d,1,1.00,01-01-2024\n", writer_id(w, k), w, k);
+        n++;
+        if (k % 4 == 0) {
+            int j = 1 + (k / 4) % SHARED;
+            switch (w) {
+            case 0:  fprintf(f, "UPDATE %d,C%d,,,,\n", j, k); break;
+            case 1:  fprintf(f, "UPDATE %d,,P%d,,,\n", j, k); break;
+            case 2:  fprintf(f, "UPDATE %d,,,%d,,\n", j, k); break;
+            default: fprintf(f, "UPDATE %d,,,,%d.00,\n", j, k); break;
+            }
+            n++;
+        }
+        if (deleted(k)) { fprintf(f, "DELETE %d\n", writer_id(w, k - 5)); n++; }
+    }
+    fclose(f);
+    return n;
+}
+
+static pid_t spawn(const char* arg, const char* script, const char* out) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!freopen(out, "w", stdout)) _exit(127);
+        execl(APP_EXE, APP_EXE, arg, script, (char*)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static int exited_ok(pid_t pid) {
+    int status = 0;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// replies that are not OK
+static int count_errors(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 1;
+    char line[256];
+    int bad = 0;
+    while (fgets(line, sizeof line, f)) bad += strncmp(line, "ERR", 3) == 0;
+    fclose(f);
+    return bad;
+}
+
+// the step of the last update any writer made to shared row j
+static int last_step(int j) {
+    int last = -1;
+    for (int k = 0; k < PER_WRITER; k += 4)
+        if (1 + (k / 4) % SHARED == j) last = k;
+    return last;
+}
+
+// every writer's rows are in the checkpointed CSV exactly once, deleted ones
+// are gone, and each shared row carries the last update of every writer
+static int verify(int writers) {
+    FILE* f = fopen(CSV, "r");
+    if (!f) { printf("[STRESS] FAIL: %s missing.\n", CSV); return 1; }
+    int total = writers * PER_WRITER;
+    unsigned char* seen = calloc((size_t)total, 1);
+    char line[256], cust[64], prod[64];
+    int id, qty, fails = 0, shared_ok = 0, dups = 0;
+    float price;
+    while (fgets(line, sizeof line, f)) {
+        if (sscanf(line, "%d,%63[^,],%63[^,],%d,%f", &id, cust, prod, &qty, &price) != 5) continue;
+        if (id >= 1 && id <= SHARED) {
+            int k = last_step(id);
+            char c[16], p[16];
+            snprintf(c, sizeof c, "C%d", k);
+            snprintf(p, sizeof p, "P%d", k);
+            if (strcmp(cust, writers > 0 ? c : "Shared") == 0
+                && strcmp(prod, writers > 1 ? p : "Item") == 0
+                && qty == (writers > 2 ? k : 1) && (int)price == (writers > 3 ? k : 1)) shared_ok++;
+            continue;
+        }
+        int w = id / 100000 - 1, k = id % 100000;
+        if (w < 0 || w >= writers || k >= PER_WRITER) continue;
+        if (seen[w * PER_WRITER + k]++) dups++;
+    }
+    fclose(f);
+    int lost = 0, kept = 0;
+    for (int w = 0; w < writers; ++w)
+        for (int k = 0; k < PER_WRITER; ++k) {
+            int gone = k + 5 < PER_WRITER && deleted(k + 5);
+            if (gone && seen[w * PER_WRITER + k]) kept++;
+            if (!gone && !seen[w * PER_WRITER + k]) lost++;
+        }
+    free(seen);
+    if (lost) { printf("[STRESS] FAIL: %d added order(s) lost.\n", lost); fails++; }
+    if (kept) { printf("[STRESS] FAIL: %d deleted order(s) came back.\n", kept); fails++; }
+    if (dups) { printf("[STRESS] FAIL: %d order(s) written twice.\n", dups); fails++; }
+    if (shared_ok != SHARED) {
+        printf("[STRESS] FAIL: %d of %d shared rows lost an update.\n", SHARED - shared_ok, SHARED); fails++;
+    }
+    return fails;
+}
+
+// run `writers` batch processes (plus the checkpointer if asked); writes/s or 0
+static double run(int writers, int checkpoint, long* writes, int* fails) {
+    char script[64], out[64];
+    pid_t pid[WRITERS];
+    *writes = 0;
+    fresh_csv();
+    for (int w = 0; w < writers; ++w) {
+        snprintf(script, sizeof script, "stress_cmd%d.txt", w);
+        *writes += write_script(w, script);
+    }
+    double t0 = now();
+    for (int w = 0; w < writers; ++w) {
+        snprintf(script, sizeof script, "stress_cmd%d.txt", w);
+        snprintf(out, sizeof out, "stress_out%d.txt", w);
+        pid[w] = spawn("--batch", script, out);
+    }
+    int cp_ok = 1;
+    struct timespec gap = { 0, 20 * 1000000L };
+    for (int i = 0; checkpoint && i < CHECKPOINTS; ++i) {
+        nanosleep(&gap, NULL);
+        cp_ok &= exited_ok(spawn("--checkpoint", NULL, "stress_cp.txt"));
+    }
+    int bad = 0;
+    for (int w = 0; w < writers; ++w) {
+        snprintf(out, sizeof out, "stress_out%d.txt", w);
+        if (!exited_ok(pid[w])) bad++;
+        bad += count_errors(out);
+    }
+    double secs = now() - t0;
+    if (!cp_ok) { printf("[STRESS] FAIL: a concurrent checkpoint failed.\n"); (*fails)++; }
+    if (bad) { printf("[STRESS] FAIL: %d writer error(s).\n", bad); (*fails)++; }
+
+    // fold the log in so the CSV alone is the answer
+    if (!exited_ok(spawn("--checkpoint", NULL, "stress_cp.txt"))) {
+        printf("[STRESS] FAIL: final checkpoint failed.\n"); (*fails)++;
+    }
+    *fails += verify(writers);
+    return secs > 0 ? *writes / secs : 0;
+}
+
+int main(void) {
+    if (!file_exists(APP_EXE) && (system(BUILD_APP) != 0 || !file_exists(APP_EXE))) {
+        printf("[STRESS] FAIL: app build failed. Is gcc in PATH?\n");
+        return 1;
+    }
+
+    int fails = 0;
+    long alone_n, all_n;
+    double alone = run(1, 0, &alone_n, &fails);
+    double all = run(WRITERS, 1, &all_n, &fails);
+    printf("[STRESS] 1 process: %ld writes, %.0f writes/s\n", alone_n, alone);
+    printf("[STRESS] %d processes + %d checkpoints: %ld writes, %.0f writes/s\n",
+           WRITERS, CHECKPOINTS, all_n, all);
+
+    for (int w = 0; w < WRITERS; ++w) {
+        char path[64];
+        snprintf(path, sizeof path, "stress_cmd%d.txt", w);
+        remove(path);
+        snprintf(path, sizeof path, "stress_out%d.txt", w);
+        remove(path);
+    }
+    remove("stress_cp.txt");
+
+    if (fails == 0) {
+        printf("[STRESS] PASS: no write was lost.\n");
+        return 0;
+    }
+    printf("[STRESS] DONE with %d failure(s).\n", fails);
+    return 1;
+}
+#else
+int main(void) {
+    printf("[STRESS] SKIP: needs fork and fcntl locks.\n");
+    return 0;
+}
+#endif